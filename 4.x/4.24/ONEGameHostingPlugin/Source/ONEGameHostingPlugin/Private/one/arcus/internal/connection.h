@@ -8,38 +8,127 @@
 #include <one/arcus/c_platform.h>
 #include <one/arcus/internal/accumulator.h>
 #include <one/arcus/internal/health.h>
+#include <one/arcus/internal/lane.h>
 #include <one/arcus/internal/ring.h>
+#include <one/arcus/internal/stats.h>
 #include <one/arcus/internal/time.h>
+#include <one/arcus/internal/trace.h>
+#include <one/arcus/message.h>
 
 namespace i3d {
 namespace one {
 
 namespace codec {
+struct EncodeOptions;
 struct Header;
 }
-class Socket;
 class Message;
+class Poller;
+class Socket;
 template <typename T>
 class RingBuffer;
 
+// Memory footprints of a connection, see connection::sizes. Note these MUST
+// be kept in sync with OneMemoryProfile in c_api.h.
+enum class MemoryProfile {
+    // Streams allocated at their largest size, so that bursts of large
+    // messages take the fewest socket calls. The default.
+    throughput = 0,
+    // Streams of a few KB, growing on demand, and a smaller payload arena,
+    // for hosts running many instances.
+    small,
+    count
+};
+
 namespace connection {
 
-// Stream buffers sizes used to pump pending data from/to the connection's
-// socket.
-constexpr size_t stream_send_buffer_size() {
+// Largest size of the stream buffers used to pump pending data from/to the
+// connection's socket, which holds the largest message frame.
+constexpr size_t stream_max_size() {
     return 1024 * 128;
 }
 
-constexpr size_t stream_receive_buffer_size() {
-    return 1024 * 128;
+// Smallest sizes of the stream buffers and the incoming arena buffer.
+constexpr size_t buffer_min_size() {
+    return 1024;
+}
+
+// Sizes of the buffers and queues of a connection.
+struct Sizes {
+    // Initial size of each of the send and receive stream buffers. Each grows
+    // on demand, up to stream_max_size(), until the connection is shut down.
+    size_t stream_size;
+    // Size of the buffer backing the arena that incoming message payloads are
+    // parsed into. Payloads needing more spill into additional chunks, which
+    // are released each time the arena is cleared.
+    size_t incoming_arena_size;
+    // Capacity of the incoming queue, and of each of the state and bulk lanes
+    // of the outgoing queue.
+    size_t max_messages_in;
+    size_t max_messages_out;
+};
+
+Sizes sizes(MemoryProfile profile);
+
+// Whether the stream and arena sizes are within the above bounds, and the
+// queues can hold a message.
+bool is_valid(const Sizes &sizes);
+
+// Capacity of the control lane of the outgoing queue, see Lane. The other
+// lanes have the capacity given to the connection.
+constexpr size_t control_lane_capacity() {
+    return 8;
+}
+
+// Data in the send stream up to which the state and bulk lanes are encoded
+// into it. Control messages are always encoded, behind at most this much
+// data and one frame of the other lanes.
+constexpr size_t lane_send_watermark() {
+    return 1024 * 16;
+}
+
+// The opcodes whose outgoing messages can be coalesced, see
+// Connection::set_coalescing: application_instance_status, live_state and
+// reverse_metadata.
+constexpr size_t coalesced_opcode_count() {
+    return 3;
 }
+Opcode coalesced_opcode(size_t index);
+// Returns coalesced_opcode_count() for an opcode that cannot be coalesced.
+size_t coalesced_index(Opcode code);
+// Whether the messages of the coalesced opcode are coalesced by default:
+// application_instance_status and live_state, which carry a whole state, but
+// not reverse_metadata, of which each message is delivered unless set
+// otherwise.
+bool is_coalesced_by_default(size_t index);
 
 }  // namespace connection
 
+// What a connection does with an incoming message arriving while its incoming
+// queue is full. Note these MUST be kept in sync with OneIncomingOverflow in
+// c_api.h.
+enum class IncomingOverflow {
+    // Fails the update with ONE_ERROR_CONNECTION_INCOMING_QUEUE_INSUFFICIENT_SPACE,
+    // which puts the connection in error.
+    error = 0,
+    // Doubles the capacity of the queue, up to the maximum set with the
+    // policy, then pauses reading.
+    grow,
+    // Leaves the remaining data in the stream and socket, and stops watching
+    // the socket for reading, until a message is removed from the queue. The
+    // remote end is held back by TCP flow control meanwhile.
+    pause,
+    // Passes the oldest queued message to the incoming dispatcher, as
+    // remove_incoming would, to make room. Pauses reading if no dispatcher is
+    // set.
+    dispatch,
+    count
+};
+
 // Connection manages Arcus protocol communication between two TCP sockets.
 class Connection final {
 public:
-    // A default that can be used for production.
+    // The queue capacities of both profiles.
     static constexpr size_t max_message_default = 48;
     static constexpr int handshake_timeout_seconds = 1;
 
@@ -47,19 +136,49 @@ public:
     // during processing will be returned as errors, and it is the caller's
     // responsibilty to either destroy the Connection, or restore the Socket's
     // state for communication.
-    // Creating the conneciton starts the handshake timeout.
-    Connection(size_t max_messages_in, size_t max_messages_out);
-    ~Connection() = default;
+    // Creating the conneciton starts the handshake timeout. The sizes must be
+    // valid, see connection::is_valid.
+    explicit Connection(const connection::Sizes &sizes);
+    ~Connection();
 
     // Init the connection with the given socket. The given socket should be
-    // active. Must be called after construction and shutdown. Handshaking timers
-    // start when init is called.
-    void init(Socket &socket);
+    // active and registered with the given poller, which must be polled before
+    // each update. Must be called after construction and shutdown. Handshaking
+    // timers start when init is called.
+    void init(Socket &socket, Poller &poller);
 
     // Clears Connection to construction state. Erases all pending incoming
-    // and outgoing data. Unassigns the socket.
+    // and outgoing data, and returns grown streams and queues to their sizes.
+    // Unassigns the socket.
     void shutdown();
 
+    // Reallocates the buffers and queues whose sizes differ from the given
+    // ones, which must be valid. Must be called while uninitialized, that is
+    // after construction or shutdown and before init.
+    void set_sizes(const connection::Sizes &sizes);
+
+    // Sets the optional capabilities supported by this side, see
+    // codec::capability. The side initiating the handshake offers them, and
+    // the other side accepts those it also supports. None are supported by
+    // default. Takes effect on the next handshake.
+    void set_supported_capabilities(char capabilities);
+
+    // The capabilities negotiated by the last handshake.
+    char capabilities() const {
+        return _capabilities;
+    }
+
+    // Sets the minimum length of outgoing payloads that are compressed, when
+    // compression was negotiated. Zero disables compression of outgoing
+    // payloads. Defaults to codec::compression_threshold_default().
+    void set_compression_threshold(size_t threshold);
+
+    // Uses the given compression scratch space, of at least
+    // codec::payload_max_size() bytes, instead of allocating one, so that
+    // connections updated from the same thread can share it. The buffer must
+    // outlive the connection.
+    void set_compression_buffer(char *buffer);
+
     // Marks this side of the connection as responsible for initiating the
     // handshaking process. Must be called from one side of the connection
     // only. Attempting to send a Message or any other data to other side of
@@ -69,7 +188,10 @@ public:
 
     // Update process incoming and outgoing messges. It attempts to read
     // all incoming messages that are available. It attempts to send all
-    // queued outgoing messages. Must be called after init.
+    // queued outgoing messages. Must be called after init. The socket is only
+    // read from if the last poll reported it as readable, and only written to
+    // if the previous send was not blocked or the socket has since become
+    // writable.
     OneError update();
 
     enum class Status {
@@ -83,19 +205,70 @@ public:
     };
     Status status() const;
 
-    // Adds a Message to the outgoing message queue, and passes the message
-    // back in a modifier function that allows the caller to configure the
-    // queued message. If the outgoing message queue is full, then the
-    // call fails with ONE_ERROR_INSUFFICIENT_SPACE and the queue is not
-    // modified. Must be called after init.
+    // Counters of the traffic of all the connections made since construction.
+    const Stats &stats() const {
+        return _stats;
+    }
+
+    // Sends the lifecycle events of the messages to the tracer, when built
+    // with ONE_ARCUS_TRACING.
+    void set_tracer(const Tracer &tracer) {
+        _tracer = tracer;
+    }
+
+    // Sets whether the outgoing messages of the given opcode, one of the
+    // connection::coalesced_opcode, are coalesced. A coalesced message does
+    // not take room in the outgoing queue, and replaces the previous message
+    // of its opcode if that one is not yet sent. It is also sent at most once
+    // every min_interval_ms milliseconds, waiting for the interval to elapse
+    // otherwise. Coalesced messages are sent after the queued ones. The
+    // defaults are connection::is_coalesced_by_default, without interval.
+    void set_coalescing(Opcode code, bool is_enabled, unsigned int min_interval_ms);
+
+    // Milliseconds until the first coalesced message waiting for its interval
+    // can be sent, or -1 if none is waiting.
+    int next_send_delay_ms() const;
+
+    // Adds a Message to the lane of its opcode in the outgoing message queue,
+    // see Lane, and assigns the queued message its packet id. If the lane is
+    // full, then the call fails with ONE_ERROR_INSUFFICIENT_SPACE and the
+    // queue is not modified. Coalesced messages never fail for lack of space.
+    // Must be called after init.
     OneError add_outgoing(const Message &message);
+    // Same as above, but moves the message into the queue instead of copying
+    // it.
+    OneError add_outgoing(Message &&message);
+
+    // Sets what is done with incoming messages arriving while the incoming
+    // queue is full, and the capacity up to which the grow policy grows it,
+    // which is at least the queue's current capacity. A queue keeps the
+    // capacity it has grown to. Defaults to IncomingOverflow::pause.
+    void set_incoming_overflow(IncomingOverflow policy, size_t max_messages);
+
+    // The callback the dispatch overflow policy passes queued messages to. The
+    // message payload is only valid during the callback, and an error fails
+    // the update. The callback may add outgoing messages, but must not
+    // otherwise use the connection.
+    using IncomingDispatcher = std::function<OneError(const Message &message)>;
+    void set_incoming_dispatcher(IncomingDispatcher dispatcher);
 
     // The number of incoming messages available for pop. Must be called after
     // init.
     OneError incoming_count(unsigned int &count) const;
 
+    // Whether the next update would queue incoming messages without the socket
+    // becoming readable: reading is paused by a full queue, or a complete
+    // frame is left in the in stream, which the poller does not report again.
+    // False while the incoming queue is still full.
+    bool has_pending_incoming() const;
+
+    // Bytes reserved by the arena that incoming message payloads are decoded
+    // into, including the chunks allocated beyond its buffer.
+    size_t incoming_arena_capacity() const;
+
     // Removes a message from the incoming message queue, but before doing so
-    // passes the message into the given callback for reading.
+    // passes the message into the given callback for reading. The message
+    // payload is only valid during the callback.
     // Returns ONE_ERROR_EMPTY if the incoming_count is
     // zero and there is no message to pop.
     // Note that some messages are internally consumed and do not show up in
@@ -107,18 +280,69 @@ public:
 private:
     Connection() = delete;
 
+    // Empties the incoming message queue and recycles the payload arena.
+    void clear_incoming_messages();
+
     OneError process_handshake();
     // Reads all available incoming messages from the socket and stores them in
-    // the incoming message queue.
+    // the incoming message queue, applying the overflow policy once it is
+    // full.
     OneError process_incoming_messages();
-    // Sends all outgoing messages in the queue as long as the socket is ready
-    // for sending.
+    // Makes room in the full incoming queue as the overflow policy allows.
+    // Returns false if reading must pause instead.
+    bool make_incoming_room(OneError &err);
+    // Stops or resumes watching the socket for reading, see
+    // IncomingOverflow::pause.
+    OneError pause_reading(bool is_paused);
+    // Encodes the queued outgoing messages that fit into the outgoing stream,
+    // by lane priority, then flushes the stream with a single send, repeated
+    // while lanes wait for the stream to drain below
+    // connection::lane_send_watermark(). Data the socket could not accept is
+    // kept and sent first on the next update.
     OneError process_outgoing_messages();
 
     OneError process_health();
 
+    void complete_handshake();
+
+    // Pushes the message written into the reserved slot of its lane.
+    void commit_outgoing(Ring<Message> &lane, Message &message);
+
+    // The latest message of a coalesced opcode.
+    struct CoalescedMessage {
+        CoalescedMessage();
+
+        bool is_enabled;
+        bool is_pending;
+        unsigned int min_interval_ms;
+        uint64_t last_sent_nanoseconds;
+        Message message;
+    };
+
+    // Returns the coalescing state of the message's opcode, or nullptr if it
+    // is not coalesced.
+    CoalescedMessage *coalesced(const Message &message);
+    // Returns a pending coalesced message of the lane whose interval has
+    // elapsed at the given time, or nullptr if none.
+    CoalescedMessage *due_coalesced(Lane lane, uint64_t nanoseconds);
+    // Replaces the pending message of the slot with the message written into
+    // it.
+    void commit_coalesced(CoalescedMessage &coalesced);
+
+    // Encodes the message into the free space of the out stream. Sets is_full
+    // if it does not fit behind the data already in the stream.
+    OneError encode_outgoing(const Message &message, const codec::EncodeOptions &options,
+                             bool &is_full);
+
+    // Socket calls, counted in the stats.
+    OneError receive_data(void *data, size_t length, size_t &received);
+    OneError send_data(const void *data, size_t length, size_t &sent);
+
     // Message helpers.
-    OneError try_read_data_into_in_stream();
+    // Receives available data into the in stream. Returns
+    // ONE_ERROR_CONNECTION_TRY_AGAIN if nothing was received, and sets
+    // is_drained if no more data is pending on the socket.
+    OneError try_read_data_into_in_stream(bool &is_drained);
     OneError try_read_message_from_in_stream(codec::Header &header, Message &message);
 
     // Handshake helpers.
@@ -129,16 +353,69 @@ private:
     OneError try_receive_hello_message();
 
     Socket *_socket;
+    Poller *_poller;
     Status _status;
 
+    // True while outgoing data is pending that the socket could not accept.
+    // The poller's write interest is enabled for the socket only during that
+    // time.
+    bool _is_waiting_for_writable;
+
+    // Id of the next queued outgoing message. All encoding and decoding state
+    // is owned by the connection, so that connections can be updated
+    // concurrently from different threads.
+    uint32_t _packet_id;
+
+    char _supported_capabilities;
+    char _capabilities;
+
+    // The compression scratch space is only allocated once compression has
+    // been negotiated, unless it is shared.
+    size_t _compression_threshold;
+    char *_compression_buffer;
+    bool _is_compression_buffer_shared;
+
+    connection::Sizes _sizes;
     Accumulator _in_stream;
     Accumulator _out_stream;
 
+    // Incoming message payloads are allocated from the arena, which is cleared
+    // after each message is dispatched, so that steady state decoding makes no
+    // heap allocations. Declared before the queues, which
+    // refer to it.
+    char *_incoming_arena_buffer;
+    JsonArena *_incoming_arena;
+
     Ring<Message> _incoming_messages;
-    Ring<Message> _outgoing_messages;
+    IncomingOverflow _incoming_overflow;
+    size_t _max_incoming_messages;
+    IncomingDispatcher _incoming_dispatcher;
+    // True while reading is paused by a full incoming queue.
+    bool _is_reading_paused;
+    // The outgoing messages, by Lane.
+    Ring<Message> *_outgoing_lanes[lane_count()];
+    CoalescedMessage _coalesced[connection::coalesced_opcode_count()];
 
     IntervalTimer _handshake_timer;
     HealthChecker _health_checker;
+
+    Stats _stats;
+    uint64_t _handshake_start_nanoseconds;
+
+    Tracer _tracer;
+#ifdef ONE_ARCUS_TRACING
+    // A frame encoded into the out stream, with the count of bytes sent since
+    // init once its last byte is sent.
+    struct PendingFrame {
+        uint32_t packet_id;
+        Opcode code;
+        uint64_t end;
+    };
+    std::vector<PendingFrame, StandardAllocator<PendingFrame>> _pending_frames;
+    uint64_t _sent_bytes;
+    // Time of the last receive of data into the in stream.
+    uint64_t _receive_nanoseconds;
+#endif
 };
 
 }  // namespace one
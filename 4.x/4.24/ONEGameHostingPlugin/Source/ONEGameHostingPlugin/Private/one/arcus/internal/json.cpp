@@ -0,0 +1,95 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include <one/arcus/internal/json.h>
+
+#include <one/arcus/allocator.h>
+
+#include <utility>
+
+namespace i3d {
+namespace one {
+
+namespace {
+
+constexpr size_t arena_chunk_size_default = 4 * 1024;
+size_t _arena_chunk_size = arena_chunk_size_default;
+
+}  // namespace
+
+void *JsonBaseAllocator::Malloc(size_t size) {
+    // rapidjson expects null for a zero size.
+    if (size == 0) {
+        return nullptr;
+    }
+    return allocator::alloc(size, allocator::Tag::payload);
+}
+
+void *JsonBaseAllocator::Realloc(void *original, size_t original_size, size_t new_size) {
+    (void)original_size;
+    if (new_size == 0) {
+        Free(original);
+        return nullptr;
+    }
+    return allocator::realloc(original, new_size, allocator::Tag::payload);
+}
+
+void JsonBaseAllocator::Free(void *p) {
+    if (p != nullptr) {
+        allocator::free(p);
+    }
+}
+
+JsonAllocator::~JsonAllocator() {
+    // The pool keeps its bookkeeping in the buffer, so it is destroyed first.
+    allocator::destroy(_pool);
+    allocator::free(_pool_buffer);
+}
+
+void *JsonAllocator::Malloc(size_t size) {
+    JsonArena *arena = (_arena != nullptr) ? _arena : pool();
+    return (arena != nullptr) ? arena->Malloc(size) : nullptr;
+}
+
+void *JsonAllocator::Realloc(void *original, size_t original_size, size_t new_size) {
+    JsonArena *arena = (_arena != nullptr) ? _arena : pool();
+    return (arena != nullptr) ? arena->Realloc(original, original_size, new_size) : nullptr;
+}
+
+void JsonAllocator::release() {
+    if (_pool != nullptr) {
+        _pool->Clear();
+    }
+}
+
+void JsonAllocator::swap(JsonAllocator &other) {
+    std::swap(_pool, other._pool);
+    std::swap(_pool_buffer, other._pool_buffer);
+}
+
+JsonArena *JsonAllocator::pool() {
+    if (_pool != nullptr) {
+        return _pool;
+    }
+
+    const size_t size = json::arena_chunk_size();
+    _pool_buffer = static_cast<char *>(allocator::alloc(size, allocator::Tag::payload));
+    if (_pool_buffer == nullptr) {
+        return nullptr;
+    }
+    _pool = allocator::create_tagged<JsonArena>(allocator::Tag::payload, _pool_buffer, size, size);
+    return _pool;
+}
+
+namespace json {
+
+void set_arena_chunk_size(size_t size) {
+    _arena_chunk_size = (size != 0) ? size : arena_chunk_size_default;
+}
+
+size_t arena_chunk_size() {
+    return _arena_chunk_size;
+}
+
+}  // namespace json
+
+}  // namespace one
+}  // namespace i3d
@@ -316,6 +316,10 @@ OneError Socket::available(size_t &length) {
 
 OneError Socket::receive(void *data, size_t length, size_t &length_received) {
     const auto result = ::recv(_socket, (char *)data, length, 0);
+    if (result == 0 && length > 0) {
+        length_received = 0;
+        return ONE_ERROR_SOCKET_CLOSED_BY_PEER;
+    }
     if (result >= 0) {
         length_received = (size_t)result;
         return ONE_ERROR_NONE;
@@ -0,0 +1,107 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <one/arcus/internal/lane.h>
+#include <one/arcus/opcode.h>
+
+namespace i3d {
+namespace one {
+namespace stats {
+
+// Message types counted separately. Note these MUST be kept in sync with
+// OneMessageType in c_api.h.
+enum class MessageType {
+    health = 0,
+    hello,
+    soft_stop,
+    allocated,
+    metadata,
+    reverse_metadata,
+    live_state,
+    host_information,
+    application_instance_information,
+    application_instance_status,
+    custom_command,
+    other,
+    count
+};
+
+constexpr size_t message_type_count() {
+    return static_cast<size_t>(MessageType::count);
+}
+
+size_t message_type_index(Opcode code);
+
+// Monotonic time for the durations, in nanoseconds.
+uint64_t now_nanoseconds();
+
+}  // namespace stats
+
+// Counters of the Arcus link, maintained by the thread doing the work they
+// count, without synchronization. The counters are cumulative since the
+// server's init, except the high-water marks.
+struct Stats {
+    Stats();
+
+    // Adds the counters of other, and keeps the higher high-water marks.
+    void add(const Stats &other);
+
+    // Counts the capacity freed by Message::release_data, if any.
+    void count_release(size_t released);
+
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    // System calls.
+    uint64_t receive_calls;
+    uint64_t send_calls;
+    uint64_t poll_calls;
+    // Message frames, including the health and hello messages consumed by
+    // the connection, by stats::MessageType.
+    uint64_t messages_received[stats::message_type_count()];
+    uint64_t messages_sent[stats::message_type_count()];
+    // Highest count of messages waiting in the connection's queues, the
+    // outgoing one being the total of its lanes.
+    uint64_t incoming_queue_high_water;
+    uint64_t outgoing_queue_high_water;
+    // Outgoing message frames and their bytes, and the highest count of
+    // messages waiting, by Lane.
+    uint64_t lane_messages_sent[lane_count()];
+    uint64_t lane_bytes_sent[lane_count()];
+    uint64_t lane_queue_high_water[lane_count()];
+    // Outgoing messages replaced by a newer message of their opcode before
+    // being sent, see Connection::set_coalescing.
+    uint64_t messages_coalesced;
+    // Incoming messages that found the incoming queue full, by the action of
+    // the overflow policy, see IncomingOverflow: growths of the queue, pauses
+    // of the reading, and queued messages dispatched to make room.
+    uint64_t incoming_queue_grows;
+    uint64_t incoming_read_pauses;
+    uint64_t incoming_inline_dispatches;
+    // Time spent encoding and compressing outgoing messages, and decoding
+    // incoming messages, including the parsing of their payloads in the I/O
+    // thread mode.
+    uint64_t encode_nanoseconds;
+    uint64_t decode_nanoseconds;
+    // Completed handshakes and their total duration, from the client
+    // connection to the connection being ready.
+    uint64_t handshakes;
+    uint64_t handshake_nanoseconds;
+    // Accepted client connections. Each connection after the first replaces
+    // a previous one.
+    uint64_t connections;
+    // Incoming messages dispatched to the callbacks, and the time spent
+    // dispatching them, including the callbacks, and the parsing of the
+    // payloads when it is not done by the I/O thread.
+    uint64_t callbacks;
+    uint64_t callback_nanoseconds;
+    // Received data buffers freed by the recycling of the queued messages, for
+    // exceeding messages::retained_data_capacity, and their total capacity.
+    uint64_t data_releases;
+    uint64_t data_released_bytes;
+};
+
+}  // namespace one
+}  // namespace i3d
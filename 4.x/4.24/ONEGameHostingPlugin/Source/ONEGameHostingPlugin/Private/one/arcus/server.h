@@ -1,12 +1,20 @@
 // Copyright i3D.net, 2021. All Rights Reserved.
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <mutex>
+#include <thread>
 
 #include <one/arcus/error.h>
+#include <one/arcus/internal/connection.h>
+#include <one/arcus/internal/stats.h>
+#include <one/arcus/internal/trace.h>
+#include <one/arcus/internal/triple_buffer.h>
 #include <one/arcus/logger.h>
+#include <one/arcus/object.h>
 #include <one/arcus/types.h>
 
 namespace i3d {
@@ -20,8 +28,11 @@ void set_listen_retry_delay(size_t seconds);
 class Array;
 class Connection;
 class Message;
-class Object;
+class Poller;
+class ServerGroup;
 class Socket;
+template <typename T>
+class SpscRing;
 
 struct ServerCallbacks {
     std::function<void(void *, int)> _soft_stop;
@@ -50,6 +61,60 @@ public:
     void set_logger(const Logger &);
     OneError init(unsigned int listen_port);
 
+    // Sends the lifecycle events of the messages to the tracer, see
+    // TraceStage. Returns ONE_ERROR_SERVER_TRACING_DISABLED unless built with
+    // ONE_ARCUS_TRACING. The tracer is called from the I/O thread when it is
+    // enabled, and must not be changed meanwhile.
+    OneError set_tracer(const Tracer &tracer);
+
+    // Offers the MessagePack payload encoding to connecting agents, instead of
+    // JSON. It is only used with agents accepting it during the handshake,
+    // JSON remains in use otherwise. Disabled by default. Takes effect on the
+    // next client connection.
+    void set_msgpack_payloads(bool enabled);
+
+    // Offers payload compression to connecting agents. Payloads of at least
+    // the given length, in bytes, are compressed in both directions when the
+    // agent accepts it and compression makes them smaller. Zero, the default,
+    // disables compression. Takes effect on the next client connection.
+    void set_compression_threshold(unsigned int threshold);
+
+    // Sets whether the outgoing messages of the given opcode are coalesced,
+    // and their minimum interval in milliseconds, see
+    // Connection::set_coalescing. Only application_instance_status, live_state
+    // and reverse_metadata can be coalesced. The first two are by default,
+    // without interval. Coalesced reverse metadata replace each other whole,
+    // rather than each being delivered. Returns
+    // ONE_ERROR_VALIDATION_MESSAGE_TYPE_NOT_COALESCABLE for other opcodes.
+    // Takes effect on the next client connection.
+    OneError set_coalescing(Opcode code, bool enabled, unsigned int min_interval_ms);
+
+    // Sets what is done with the incoming messages arriving while the
+    // connection's incoming queue is full, see Connection::set_incoming_overflow.
+    // The dispatch policy calls the callbacks from within the update, and
+    // pauses instead while the I/O thread runs, since the callbacks are then
+    // only called by update. Defaults to IncomingOverflow::pause. Takes effect
+    // on the next client connection.
+    void set_incoming_overflow(IncomingOverflow policy, unsigned int max_messages);
+
+    // Sets the sizes of the buffers and queues of the client connection, see
+    // connection::Sizes, or those of a profile. Defaults to
+    // MemoryProfile::throughput. Returns
+    // ONE_ERROR_VALIDATION_MEMORY_SIZES_ARE_INVALID for sizes out of bounds.
+    // Takes effect on the next client connection.
+    OneError set_memory_sizes(const connection::Sizes &sizes);
+    OneError set_memory_profile(MemoryProfile profile);
+
+    // Moves the socket I/O, the message encoding and decoding, and the parsing
+    // of received payloads to a dedicated SDK thread. Update then only calls
+    // the callbacks of the received messages and queues the outgoing ones,
+    // without any system call. The threads exchange messages through lock-free
+    // queues. Disabled by default. Must be called after init. While enabled,
+    // the logger is called from the I/O thread and must not be changed.
+    // Unavailable for a server in a ServerGroup.
+    OneError set_io_thread(bool enabled);
+
+    // Removes the server from its ServerGroup, if any.
     OneError shutdown();
 
     // Note these MUST be kept in sync with the values in c_api.cpp, or
@@ -65,6 +130,12 @@ public:
     Status status() const;
     static String status_to_string(Status status);
 
+    // Copies the counters of the Arcus link since init, see Stats. Cheap
+    // enough to be called every frame, it takes the server lock and makes no
+    // system call. With the I/O thread, the link counters are as of its last
+    // update.
+    OneError stats(Stats &stats);
+
     // Process pending received and outgoing messages. Any incoming messages are
     // validated according to the Arcus API version standard, and callbacks, if
     // set, are called. Messages without callbacks set are dropped and ignored.
@@ -75,11 +146,39 @@ public:
     // If a connection to a client fails, then the server waits for a new connection.
     // If a new client connects while an existing client is connected, then
     // the existing client is closed.
+    //
+    // A server in a ServerGroup is updated by the group instead, and returns
+    // ONE_ERROR_SERVER_IS_IN_GROUP here, as do wait and descriptor.
     OneError update();
 
+    // Blocks the calling thread until update has work to do, or for at most
+    // timeout_ms milliseconds. The work is a received message, a connecting
+    // client, a socket ready to send queued messages, a changed property to
+    // send, or a call to wake. Returns immediately if some is already pending.
+    // A negative timeout, or one longer than a second, is capped to a second
+    // so that the timers of the connection keep running.
+    //
+    // Meant to be called in a loop with update, instead of sleeping between
+    // updates, on the thread calling update. Must not be called concurrently
+    // with init, shutdown or set_io_thread.
+    OneError wait(int timeout_ms);
+
+    // Ends a concurrent or the next wait. Thread-safe.
+    void wake();
+
+    // Sets descriptor to a file descriptor that is readable whenever wait
+    // would return, so that the server can be nested in another event loop,
+    // with update called when it is readable. It is valid until shutdown.
+    // Returns ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE on Windows, and while
+    // the I/O thread is enabled, since its sockets are then polled by the I/O
+    // thread.
+    OneError descriptor(int &descriptor) const;
+
     //------------------------------------------------------------------------------
     // Property setters.
 
+    // Publishes the live state, which update sends when it changed. It does
+    // not wait for a concurrent update, only for other set_live_state calls.
     OneError set_live_state(int players, int max_players, const char *name,
                             const char *map, const char *mode, const char *version,
                             Object *additional_data);
@@ -136,8 +235,59 @@ public:
                                          void *data);
 
 private:
+    friend class ServerGroup;
+
+    // Bits of the live state fields.
+    enum LiveStateField : unsigned {
+        live_state_players = 1 << 0,
+        live_state_max_players = 1 << 1,
+        live_state_name = 1 << 2,
+        live_state_map = 1 << 3,
+        live_state_mode = 1 << 4,
+        live_state_version = 1 << 5,
+        live_state_additional_data = 1 << 6
+    };
+
+    // Identifies the values of the live state fields, so that a change is
+    // detected by comparing a few integers. The strings are identified by the
+    // version they were last written at, and the additional data by its
+    // Object::version. The default digest is that of the default state.
+    struct GameStateDigest {
+        GameStateDigest()
+            : players(0)
+            , max_players(0)
+            , name(0)
+            , map(0)
+            , mode(0)
+            , version(0)
+            , additional_data(0)
+            , has_additional_data(false) {}
+
+        // Returns the LiveStateField bits of the fields that differ from
+        // other's.
+        unsigned changed_fields(const GameStateDigest &other) const;
+
+        int players;
+        int max_players;
+        uint64_t name;
+        uint64_t map;
+        uint64_t mode;
+        uint64_t version;
+        uint64_t additional_data;
+        bool has_additional_data;
+    };
+
     struct GameState {
-        GameState() : players(0), max_players(0), name(), map(), mode(), version() {}
+        GameState()
+            : players(0)
+            , max_players(0)
+            , name()
+            , map()
+            , mode()
+            , version()
+            , additional_data()
+            , has_additional_data(false)
+            , digest() {}
 
         int players;      // Game number of players.
         int max_players;  // Game max number of players.
@@ -146,23 +296,71 @@ private:
         String mode;      // Game mode.
         String version;   // Game version.
 
-        Object *additional_data;  // Optional extra fields.
+        Object additional_data;    // Optional extra fields.
+        bool has_additional_data;  // Whether to send the extra fields.
+
+        GameStateDigest digest;  // Digest of the above fields.
     };
-    static bool game_states_changed(Server::GameState &new_state,
-                                    Server::GameState &old_state);
 
     bool is_initialized() const;
+    Status connection_status() const;
+    // Creates the sockets and the connection, and starts listening, once the
+    // poller is set. Shuts the server down on failure.
+    OneError init_sockets();
+    // Shutdown, with the server lock held.
+    OneError shutdown_server();
+    // Updates the listen socket and the connection, from the readiness of the
+    // last poll.
+    OneError update_sockets();
+
+    // ServerGroup side, called with the group lock held. The server shares the
+    // group's poller and compression scratch space.
+    OneError init_in_group(unsigned int listen_port, ServerGroup &group, Poller &poller,
+                           char *compression_buffer);
+    OneError update_in_group();
+
     OneError listen();
-    OneError update_client_connection();
+    // When called from the I/O thread, incoming messages are forwarded to the
+    // game thread instead of being processed.
+    OneError update_client_connection(bool is_io_thread);
     OneError update_listen_socket();
     void close_client_connection();
-
+    // The sizes last set by set_memory_sizes.
+    connection::Sizes memory_sizes() const;
+    // Sends the game state and application instance status, if they changed
+    // since last sent.
+    OneError send_pending_state();
+    // Whether update would send state or dispatch messages without waiting
+    // for the sockets.
+    bool has_pending_work() const;
+    // Wakes a concurrent wait, if any, or schedules the server for the next
+    // update of its group, after a property was set.
+    void wake_waiter();
+
+    // I/O thread mode, see set_io_thread. The I/O thread owns the sockets and
+    // the connection while it runs.
+    void stop_io_thread();
+    void io_thread_loop();
+    OneError update_io_thread();
+    OneError forward_incoming_message(const Message &message);
+    OneError forward_io_commands(bool is_ready);
+    // Game thread side of the I/O thread mode: processes the forwarded
+    // incoming messages.
+    OneError dispatch_io_events();
+    OneError update_from_io_thread();
+
+    // Processes the message, counting it in the stats.
+    OneError dispatch_incoming_message(const Message &message);
+    // Dispatches a message received by the connection on the game thread.
+    OneError dispatch_received_message(const Message &message);
     OneError process_incoming_message(const Message &message);
+    // The counters of the connection and the socket side of the server.
+    void socket_stats(Stats &stats) const;
     // The server must have an active and ready listen connection in order to
     // send outgoing messages. If not, either ONE_ERROR_SERVER_CONNECTION_IS_NULLPTR or
     // ONE_ERROR_SERVER_CONNECTION_NOT_READY is returned and the message is
-    // not sent.
-    OneError process_outgoing_message(const Message &message);
+    // not sent. The message is moved into the outgoing queue.
+    OneError process_outgoing_message(Message &&message);
 
     OneError send_live_state();
     OneError send_application_instance_status();
@@ -173,14 +371,40 @@ private:
 
     unsigned int _listen_port;
     bool _is_listening;
+    Poller *_poller;
     Socket *_listen_socket;
     Socket *_client_socket;
     Connection *_client_connection;
 
     bool _is_waiting_for_client;
-
-    GameState _game_state;
-    GameState _last_sent_game_state;
+    // Read by the I/O thread when a client connects.
+    std::atomic<bool> _is_msgpack_enabled;
+    std::atomic<unsigned int> _compression_threshold;
+    std::atomic<bool> _is_coalescing[connection::coalesced_opcode_count()];
+    std::atomic<unsigned int> _coalescing_interval_ms[connection::coalesced_opcode_count()];
+    std::atomic<IncomingOverflow> _incoming_overflow;
+    std::atomic<unsigned int> _max_incoming_messages;
+    std::atomic<size_t> _stream_size;
+    std::atomic<size_t> _incoming_arena_size;
+    std::atomic<size_t> _max_messages_in;
+    std::atomic<size_t> _max_messages_out;
+
+    // The live state is written by set_live_state and read by update, which
+    // may run on different threads. Writers are serialized by their own mutex
+    // and never wait for update. A state is only published when it differs
+    // from the last one written, and only sent when it differs from the last
+    // one sent, which are both kept as digests.
+    std::mutex _live_state_writer;
+    TripleBuffer<GameState> _live_state;
+    GameStateDigest _last_written_game_state;
+    // The strings last written, which set_live_state compares the given ones
+    // with, and the version of the last string written.
+    String _last_written_name;
+    String _last_written_map;
+    String _last_written_mode;
+    String _last_written_version;
+    uint64_t _last_string_version;
+    GameStateDigest _last_sent_game_state;
     bool _game_state_was_set;
 
     ApplicationInstanceStatus _status;
@@ -189,7 +413,50 @@ private:
     ServerCallbacks _callbacks;
     std::chrono::steady_clock::time_point _last_listen_attempt_time;
 
-    Object *_additional_data;
+    // Serializes wake with the creation and destruction of the poller, and
+    // guards the wake flag. Locked after _server when both are needed.
+    std::mutex _waiter;
+    std::condition_variable _wait_condition;
+    // Set by wake. The waits of the I/O thread mode are on the condition,
+    // since the poller is then used by the I/O thread.
+    bool _is_woken;
+    // Set during wait, so that property setters only make the wake system
+    // call when a thread waits.
+    std::atomic<bool> _is_waiting;
+
+    std::thread _io_thread;
+    std::atomic<bool> _is_io_thread_running;
+    // Received messages, already parsed, from the I/O thread to update. A
+    // hello message notifies that a client connection became ready.
+    SpscRing<Message> *_io_events;
+    // Outgoing messages, from the game thread to the I/O thread.
+    SpscRing<Message> *_io_commands;
+    // Published by the I/O thread after each of its updates.
+    std::atomic<Status> _io_status;
+    std::atomic<OneError> _io_error;
+    // Owned by the I/O thread, set while the ready notification does not fit
+    // in the event queue.
+    bool _is_ready_event_pending;
+    // Owned by the I/O thread, set when an update forwarded events.
+    bool _has_forwarded_events;
+
+    // Counters of the thread doing the socket I/O, and of the thread calling
+    // update. The I/O thread publishes a snapshot of its counters after each
+    // of its updates.
+    Stats _stats;
+    Stats _dispatch_stats;
+    TripleBuffer<Stats> _io_stats;
+
+    Tracer _tracer;
+
+    // Set while the server is in a group, which then owns the poller. Read by
+    // property setters to schedule the server.
+    std::atomic<ServerGroup *> _group;
+    // Set while the server waits in the group's schedule.
+    std::atomic<bool> _is_scheduled;
+    // The group update that last updated the server, so that it is only
+    // updated once per group update. Owned by the group.
+    size_t _group_update_count;
 };
 
 }  // namespace one
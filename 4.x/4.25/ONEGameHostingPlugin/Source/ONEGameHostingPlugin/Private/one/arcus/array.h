@@ -2,14 +2,12 @@
 #pragma once
 
 #include <one/arcus/error.h>
-#include <one/arcus/internal/rapidjson/document.h>
+#include <one/arcus/internal/json.h>
 #include <one/arcus/types.h>
 
 #include <functional>
 #include <utility>
 
-namespace rapidjson = RAPIDJSON_NAMESPACE;
-
 namespace i3d {
 namespace one {
 
@@ -23,8 +21,8 @@ public:
     Array &operator=(const Array &other);
     ~Array() = default;
 
-    OneError set(const rapidjson::Value &array);
-    const rapidjson::Value &get() const {
+    OneError set(const JsonValue &array);
+    const JsonValue &get() const {
         return _doc;
     }
 
@@ -66,7 +64,7 @@ public:
     OneError set_val_object(unsigned int pos, const Object &val);
 
 private:
-    rapidjson::Document _doc;
+    JsonDocument _doc;
 };
 
 }  // namespace one
@@ -1,6 +1,7 @@
 // Copyright i3D.net, 2021. All Rights Reserved.
 #include <one/arcus/internal/accumulator.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <cstring>
 
@@ -9,8 +10,13 @@
 namespace i3d {
 namespace one {
 
-Accumulator::Accumulator(size_t capacity) : _capacity(capacity), _size(0) {
-    void *p = allocator::alloc(sizeof(char) * capacity);
+Accumulator::Accumulator(size_t capacity, size_t max_capacity)
+    : _capacity(capacity)
+    , _max_capacity(max_capacity)
+    , _begin(0)
+    , _size(0) {
+    assert(capacity <= max_capacity);
+    void *p = allocator::alloc(sizeof(char) * capacity, allocator::Tag::connection);
     assert(p);
     _buffer = reinterpret_cast<char *>(p);
 }
@@ -30,7 +36,10 @@ void Accumulator::put(const void *data, size_t length) {
         return;
     }
     assert(_size + length <= _capacity);
-    memcpy(_buffer + _size, data, length);
+    if (_begin + _size + length > _capacity) {
+        compact();
+    }
+    memcpy(_buffer + _begin + _size, data, length);
     _size += length;
 }
 
@@ -41,8 +50,18 @@ void Accumulator::peek(size_t length, void **data) {
     assert(data);
     assert(length <= _size);
     // 'length' is only used for assertion, a void cast prevents unreferenced formal parameter warning.
-    (void)length;   
-    *data = _buffer;
+    (void)length;
+    *data = _buffer + _begin;
+}
+
+void Accumulator::peek(size_t length, const void **data) const {
+    if (_buffer == nullptr) {
+        return;
+    }
+    assert(data);
+    assert(length <= _size);
+    (void)length;
+    *data = _buffer + _begin;
 }
 
 void Accumulator::trim(size_t length) {
@@ -53,8 +72,10 @@ void Accumulator::trim(size_t length) {
         return;
     }
     assert(length <= _size);
-    memmove(_buffer, _buffer + length, _size - length);
     _size -= length;
+    // Restart from the front of the buffer once empty, which is the common
+    // case, so that compaction is rarely needed.
+    _begin = (_size == 0) ? 0 : _begin + length;
 }
 
 void Accumulator::get(size_t length, void **data) {
@@ -62,5 +83,70 @@ void Accumulator::get(size_t length, void **data) {
     trim(length);
 }
 
+void Accumulator::reserve(void **data, size_t &length) {
+    assert(data);
+    length = 0;
+    if (_buffer == nullptr) {
+        return;
+    }
+    // Only compact once the space freed at the front outgrows the space left
+    // at the end. This bounds the bytes moved by the data consumed since the
+    // last compaction.
+    const size_t tail = _capacity - _begin - _size;
+    if (_begin > tail) {
+        compact();
+    }
+    *data = _buffer + _begin + _size;
+    length = _capacity - _begin - _size;
+}
+
+void Accumulator::commit(size_t length) {
+    if (_buffer == nullptr) {
+        return;
+    }
+    assert(_begin + _size + length <= _capacity);
+    _size += length;
+}
+
+bool Accumulator::grow() {
+    if (_buffer == nullptr || _capacity == _max_capacity) {
+        return false;
+    }
+    return reallocate(std::min(_capacity * 2, _max_capacity));
+}
+
+void Accumulator::reset(size_t capacity) {
+    assert(capacity <= _max_capacity);
+    clear();
+    if (_capacity != capacity) {
+        reallocate(capacity);
+    }
+}
+
+bool Accumulator::reallocate(size_t capacity) {
+    assert(_size <= capacity);
+    void *p = allocator::alloc(sizeof(char) * capacity, allocator::Tag::connection);
+    if (p == nullptr) {
+        return false;
+    }
+    char *buffer = reinterpret_cast<char *>(p);
+    if (_buffer != nullptr) {
+        memcpy(buffer, _buffer + _begin, _size);
+        allocator::free(_buffer);
+    }
+    _buffer = buffer;
+    _capacity = capacity;
+    _begin = 0;
+    return true;
+}
+
+void Accumulator::compact() {
+    if (_begin == 0) {
+        return;
+    }
+    memmove(_buffer, _buffer + _begin, _size);
+    _begin = 0;
+}
+
 }  // namespace one
 }  // namespace i3d
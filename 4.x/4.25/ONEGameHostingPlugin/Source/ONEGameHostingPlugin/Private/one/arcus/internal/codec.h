@@ -2,6 +2,7 @@
 #pragma once
 
 #include <one/arcus/error.h>
+#include <one/arcus/message.h>
 #include <one/arcus/opcode.h>
 
 #include <stdint.h>
@@ -10,20 +11,20 @@
 namespace i3d {
 namespace one {
 
-class Message;
-class Payload;
-
 // The codec provides conversion to and from byte data for Arcus types.
 namespace codec {
 
 //-----------------
 // Handshake Hello.
 
-// The first packet, used for handshaking, is a hello packet.
+// The first packet, used for handshaking, is a hello packet. The initiater of
+// the handshake offers optional capabilities in it, and the hello message sent
+// in reply carries the offered capabilities that are accepted in its header
+// flags. Peers that do not support capabilities offer and accept none.
 struct Hello {
     char id[4];
     char version;
-    char dummy;
+    char capabilities;
 };
 static_assert(sizeof(Hello) == 6, "hello struct alignment");
 
@@ -31,16 +32,33 @@ constexpr size_t hello_size() {
     return sizeof(Hello);
 }
 
-// Returns true if the given Hello version is compatible with this version of the SDK.
+// Optional capabilities that can be negotiated during the handshake. Each
+// capability has the value of the header flag it enables.
+namespace capability {
+
+constexpr char none = 0x0;
+// Payloads may be encoded as MessagePack instead of JSON.
+constexpr char msgpack = 0x1;
+// Large payloads may be compressed.
+constexpr char compression = 0x2;
+// All the capabilities supported by this version of the SDK.
+constexpr char all = msgpack | compression;
+
+}  // namespace capability
+
+// Returns true if the given Hello version is compatible with this version of
+// the SDK. Capabilities are not validated, unknown capabilities are not
+// accepted.
 bool validate_hello(const Hello &hello);
 
-// Returns the valid, expected Hello values.
+// Returns the valid, expected Hello values, offering no capabilities.
 const Hello &valid_hello();
 
 //---------------
 // Arcus Message.
 
-// Header for regular Arcus messages.
+// Header for regular Arcus messages. The flags describe the encoding of the
+// payload, see header_flag.
 struct Header {
     char flags;
     char opcode;
@@ -63,21 +81,76 @@ constexpr size_t payload_max_size() {
 static_assert(sizeof(header_size() + payload_max_size()) <= 1024 * 128,
               "max header and payload size");
 
+// Header flags. A flag must only be set if its capability was negotiated.
+namespace header_flag {
+
+constexpr char none = 0x0;
+// The payload is encoded as MessagePack instead of JSON.
+constexpr char msgpack = capability::msgpack;
+// The payload is compressed, see compressed_payload_prefix_size.
+constexpr char compressed = capability::compression;
+constexpr char all = msgpack | compressed;
+
+}  // namespace header_flag
+
+// A compressed payload starts with its uncompressed length, in the byte order
+// of the header fields, followed by the payload compressed in the LZ4 block
+// format. The uncompressed length is at most payload_max_size().
+constexpr size_t compressed_payload_prefix_size() {
+    return sizeof(uint32_t);
+}
+
+// Default minimum payload length for compression. Smaller payloads rarely
+// compress well enough to be worth the CPU time.
+constexpr size_t compression_threshold_default() {
+    return 1024;
+}
+
+// How message_to_data encodes payloads.
+struct EncodeOptions {
+    PayloadEncoding encoding;
+    // Payloads of at least this length are compressed, if that makes them
+    // smaller. Zero disables compression.
+    size_t compression_threshold;
+    // Scratch space of at least payload_max_size() bytes, required when
+    // compression is enabled.
+    char *compression_buffer;
+};
+
 // Returns true if the given Header matches what is expected by
 // this version of the SDK.
 bool validate_header(const Header &header);
 
+// Returns the payload encoding of messages sent with the given negotiated
+// capabilities.
+PayloadEncoding payload_encoding(char capabilities);
+
+// Returns the options to encode messages sent with the given negotiated
+// capabilities. Compression is only enabled if it was negotiated and the
+// threshold is not zero.
+EncodeOptions encode_options(char capabilities, size_t compression_threshold,
+                             char *compression_buffer);
+
 // Convert the first message from data from at most data_size bytes. The read_data_size
 // will contain the number of byte read and be equal to: codec::header_size() +
 // header.length. The read_data_size is at least codec::header_size() and at most
 // codec::header_size() + codec::payload_max_size().
+// The payload is not parsed, see Message::decode. It is expected in the
+// encoding given by the header flags, and is decompressed if flagged as
+// compressed. Returns ONE_ERROR_CODEC_INVALID_COMPRESSED_PAYLOAD if that fails.
 OneError data_to_message(const void *data, const size_t data_size, size_t &read_data_size,
                       Header &header, Message &message);
 
-// Convert a Message to byte data.
+// Convert a Message to byte data, writing the header and payload directly to
+// the given data of at most capacity bytes. The payload is written in the
+// encoding of the options, which is flagged in the header, and compressed
+// when the options allow it. data_length is set to the number of bytes
+// written: codec::header_size() + the payload length. Returns
+// ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_PAYLOAD if the message does not fit
+// in capacity, in which case the content of data is undefined.
 OneError message_to_data(const uint32_t packet_id, const Message &message,
-                      size_t &data_length,
-                      std::array<char, header_size() + payload_max_size()> &data);
+                         const EncodeOptions &options, void *data, size_t capacity,
+                         size_t &data_length);
 
 // Convert byte data to a Header. Length must be header_size().
 OneError data_to_header(const void *data, size_t length, Header &header);
@@ -85,12 +158,17 @@ OneError data_to_header(const void *data, size_t length, Header &header);
 // Convert a Header to byte data.
 OneError header_to_data(const Header &header, std::array<char, header_size()> &data);
 
-// Convert byte data to a Payload. Length must be at most payload_max_size().
-OneError data_to_payload(const void *data, size_t length, Payload &payload);
-
-// Convert a Payload to byte data.
-OneError payload_to_data(const Payload &payload, size_t &payload_length,
-                      std::array<char, payload_max_size()> &data);
+// Convert byte data in the given encoding to a Payload. Length must be at most
+// payload_max_size().
+OneError data_to_payload(const void *data, size_t length, PayloadEncoding encoding,
+                         Payload &payload);
+
+// Convert a Payload to byte data in the given encoding, writing it directly to
+// the given data of at most capacity bytes. Returns
+// ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_PAYLOAD if the payload does not fit
+// in capacity.
+OneError payload_to_data(const Payload &payload, PayloadEncoding encoding, void *data,
+                         size_t capacity, size_t &payload_length);
 
 }  // namespace codec
 }  // namespace one
@@ -0,0 +1,204 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include <one/arcus/internal/lz4.h>
+
+#include <stdint.h>
+#include <cstring>
+
+namespace i3d {
+namespace one {
+namespace lz4 {
+
+namespace {
+
+// Constants of the block format.
+constexpr size_t min_match = 4;
+// The last bytes of a block are always literals.
+constexpr size_t last_literals = 5;
+// The last match must start at least this many bytes before the end.
+constexpr size_t match_find_limit = 12;
+constexpr size_t max_offset = 65535;
+// Token nibble value announcing additional length bytes.
+constexpr size_t run_mask = 15;
+
+constexpr unsigned hash_bits = 12;
+constexpr size_t hash_size = size_t(1) << hash_bits;
+
+uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+unsigned hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - hash_bits);
+}
+
+// Writes to a fixed size buffer, failing instead of writing past its end.
+class Output final {
+public:
+    Output(void *data, size_t capacity)
+        : _data(static_cast<uint8_t *>(data)), _capacity(capacity), _size(0) {}
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool put(uint8_t byte) {
+        if (_size == _capacity) return false;
+        _data[_size++] = byte;
+        return true;
+    }
+
+    bool put(const uint8_t *data, size_t length) {
+        if (_capacity - _size < length) return false;
+        std::memcpy(_data + _size, data, length);
+        _size += length;
+        return true;
+    }
+
+    // Writes the part of a length that does not fit in its token nibble.
+    bool put_length(size_t length) {
+        for (; length >= 255; length -= 255) {
+            if (!put(255)) return false;
+        }
+        return put(static_cast<uint8_t>(length));
+    }
+
+    // Writes a sequence of literals, followed by a match unless it is the last
+    // sequence, signaled by a zero match length.
+    bool put_sequence(const uint8_t *literals, size_t literal_length, size_t offset,
+                      size_t match_length) {
+        const size_t match_code = (match_length > 0) ? match_length - min_match : 0;
+        const size_t literal_nibble =
+            (literal_length < run_mask) ? literal_length : run_mask;
+        const size_t match_nibble = (match_code < run_mask) ? match_code : run_mask;
+        if (!put(static_cast<uint8_t>((literal_nibble << 4) | match_nibble))) return false;
+        if (literal_nibble == run_mask && !put_length(literal_length - run_mask))
+            return false;
+        if (!put(literals, literal_length)) return false;
+        if (match_length == 0) return true;
+
+        if (!put(static_cast<uint8_t>(offset)) || !put(static_cast<uint8_t>(offset >> 8)))
+            return false;
+        if (match_nibble == run_mask && !put_length(match_code - run_mask)) return false;
+        return true;
+    }
+
+private:
+    uint8_t *_data;
+    const size_t _capacity;
+    size_t _size;
+};
+
+}  // namespace
+
+bool compress(const void *source, size_t source_size, void *destination,
+              size_t capacity, size_t &destination_size) {
+    const uint8_t *const src = static_cast<const uint8_t *>(source);
+    Output output(destination, capacity);
+
+    size_t anchor = 0;
+    if (source_size > match_find_limit) {
+        // See: https://en.cppreference.com/w/cpp/language/value_initialization
+        // C++11 Value initialization
+        uint32_t table[hash_size]{};
+        const size_t match_start_limit = source_size - match_find_limit;
+        const size_t match_end_limit = source_size - last_literals;
+
+        size_t pos = 0;
+        while (pos <= match_start_limit) {
+            const uint32_t sequence = read32(src + pos);
+            const unsigned h = hash(sequence);
+            const size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(pos);
+
+            if (candidate >= pos || pos - candidate > max_offset ||
+                read32(src + candidate) != sequence) {
+                pos++;
+                continue;
+            }
+
+            size_t length = min_match;
+            while (pos + length < match_end_limit &&
+                   src[candidate + length] == src[pos + length]) {
+                length++;
+            }
+
+            if (!output.put_sequence(src + anchor, pos - anchor, pos - candidate,
+                                     length)) {
+                return false;
+            }
+            pos += length;
+            anchor = pos;
+        }
+    }
+
+    if (!output.put_sequence(src + anchor, source_size - anchor, 0, 0)) {
+        return false;
+    }
+
+    destination_size = output.size();
+    return true;
+}
+
+bool decompress(const void *source, size_t source_size, void *destination,
+                size_t destination_size) {
+    const uint8_t *in = static_cast<const uint8_t *>(source);
+    const uint8_t *const in_end = in + source_size;
+    uint8_t *const out_begin = static_cast<uint8_t *>(destination);
+    uint8_t *out = out_begin;
+    uint8_t *const out_end = out_begin + destination_size;
+
+    // Reads the part of a length that did not fit in its token nibble.
+    auto get_length = [&](size_t &length) -> bool {
+        uint8_t byte;
+        do {
+            if (in == in_end) return false;
+            byte = *in++;
+            length += byte;
+            // A valid length never exceeds the destination size.
+            if (length > destination_size) return false;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (in < in_end) {
+        const uint8_t token = *in++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == run_mask && !get_length(literal_length)) return false;
+        if (static_cast<size_t>(in_end - in) < literal_length ||
+            static_cast<size_t>(out_end - out) < literal_length) {
+            return false;
+        }
+        std::memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        // The last sequence has no match.
+        if (in == in_end) break;
+
+        if (in_end - in < 2) return false;
+        const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > static_cast<size_t>(out - out_begin)) return false;
+
+        size_t match_length = token & run_mask;
+        if (match_length == run_mask && !get_length(match_length)) return false;
+        match_length += min_match;
+        if (static_cast<size_t>(out_end - out) < match_length) return false;
+
+        // The match may overlap the output being written, so copy bytewise.
+        const uint8_t *match = out - offset;
+        for (size_t i = 0; i < match_length; ++i) {
+            out[i] = match[i];
+        }
+        out += match_length;
+    }
+
+    return out == out_end;
+}
+
+}  // namespace lz4
+}  // namespace one
+}  // namespace i3d
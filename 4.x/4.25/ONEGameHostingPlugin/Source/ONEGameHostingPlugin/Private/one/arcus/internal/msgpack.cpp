@@ -0,0 +1,391 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include <one/arcus/internal/msgpack.h>
+
+#include <stdint.h>
+#include <cstring>
+
+namespace i3d {
+namespace one {
+namespace msgpack {
+
+namespace {
+
+// Format bytes, see the specification.
+enum : uint8_t {
+    positive_fixint_max = 0x7f,
+    fixmap = 0x80,
+    fixarray = 0x90,
+    fixstr = 0xa0,
+    nil = 0xc0,
+    false_value = 0xc2,
+    true_value = 0xc3,
+    float32 = 0xca,
+    float64 = 0xcb,
+    uint8 = 0xcc,
+    uint16 = 0xcd,
+    uint32 = 0xce,
+    uint64 = 0xcf,
+    int8 = 0xd0,
+    int16 = 0xd1,
+    int32 = 0xd2,
+    int64 = 0xd3,
+    str8 = 0xd9,
+    str16 = 0xda,
+    str32 = 0xdb,
+    array16 = 0xdc,
+    array32 = 0xdd,
+    map16 = 0xde,
+    map32 = 0xdf,
+    negative_fixint_min = 0xe0,
+};
+
+// Writes to a fixed size buffer. Writes past the end of the buffer are dropped
+// and flag the writer as overflowed.
+class Writer final {
+public:
+    Writer(void *data, size_t capacity)
+        : _data(static_cast<uint8_t *>(data)), _capacity(capacity), _size(0) {}
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool overflowed() const {
+        return _size > _capacity;
+    }
+
+    void write(const JsonValue &value) {
+        switch (value.GetType()) {
+            case rapidjson::kNullType:
+                put(nil);
+                break;
+            case rapidjson::kFalseType:
+                put(false_value);
+                break;
+            case rapidjson::kTrueType:
+                put(true_value);
+                break;
+            case rapidjson::kObjectType:
+                put_length(value.MemberCount(), fixmap, 15, map16, map32);
+                for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+                    write(it->name);
+                    write(it->value);
+                }
+                break;
+            case rapidjson::kArrayType:
+                put_length(value.Size(), fixarray, 15, array16, array32);
+                for (auto it = value.Begin(); it != value.End(); ++it) {
+                    write(*it);
+                }
+                break;
+            case rapidjson::kStringType:
+                write_string(value.GetString(), value.GetStringLength());
+                break;
+            case rapidjson::kNumberType:
+                if (value.IsUint64()) {
+                    write_uint(value.GetUint64());
+                } else if (value.IsInt64()) {
+                    write_int(value.GetInt64());
+                } else {
+                    write_double(value.GetDouble());
+                }
+                break;
+        }
+    }
+
+private:
+    void put(uint8_t byte) {
+        if (_size < _capacity) {
+            _data[_size] = byte;
+        }
+        _size++;
+    }
+
+    void put(const void *data, size_t length) {
+        if (length <= _capacity && _size <= _capacity - length) {
+            std::memcpy(_data + _size, data, length);
+        }
+        _size += length;
+    }
+
+    // Writes the value in big endian order on the given number of bytes.
+    void put_big_endian(uint64_t value, size_t bytes) {
+        for (size_t i = bytes; i > 0; --i) {
+            put(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+        }
+    }
+
+    void put_length(size_t length, uint8_t fix, size_t fix_max, uint8_t format16,
+                    uint8_t format32) {
+        if (length <= fix_max) {
+            put(static_cast<uint8_t>(fix | length));
+        } else if (length <= UINT16_MAX) {
+            put(format16);
+            put_big_endian(length, 2);
+        } else {
+            put(format32);
+            put_big_endian(length, 4);
+        }
+    }
+
+    void write_string(const char *str, size_t length) {
+        if (length <= 31) {
+            put(static_cast<uint8_t>(fixstr | length));
+        } else if (length <= UINT8_MAX) {
+            put(str8);
+            put_big_endian(length, 1);
+        } else if (length <= UINT16_MAX) {
+            put(str16);
+            put_big_endian(length, 2);
+        } else {
+            put(str32);
+            put_big_endian(length, 4);
+        }
+        put(str, length);
+    }
+
+    void write_uint(uint64_t value) {
+        if (value <= positive_fixint_max) {
+            put(static_cast<uint8_t>(value));
+        } else if (value <= UINT8_MAX) {
+            put(uint8);
+            put_big_endian(value, 1);
+        } else if (value <= UINT16_MAX) {
+            put(uint16);
+            put_big_endian(value, 2);
+        } else if (value <= UINT32_MAX) {
+            put(uint32);
+            put_big_endian(value, 4);
+        } else {
+            put(uint64);
+            put_big_endian(value, 8);
+        }
+    }
+
+    // Only called for negative values, others are written as unsigned.
+    void write_int(int64_t value) {
+        if (value >= -32) {
+            put(static_cast<uint8_t>(value));
+        } else if (value >= INT8_MIN) {
+            put(int8);
+            put_big_endian(static_cast<uint64_t>(value), 1);
+        } else if (value >= INT16_MIN) {
+            put(int16);
+            put_big_endian(static_cast<uint64_t>(value), 2);
+        } else if (value >= INT32_MIN) {
+            put(int32);
+            put_big_endian(static_cast<uint64_t>(value), 4);
+        } else {
+            put(int64);
+            put_big_endian(static_cast<uint64_t>(value), 8);
+        }
+    }
+
+    void write_double(double value) {
+        uint64_t bits = 0;
+        static_assert(sizeof(bits) == sizeof(value), "double size");
+        std::memcpy(&bits, &value, sizeof(bits));
+        put(float64);
+        put_big_endian(bits, 8);
+    }
+
+    uint8_t *_data;
+    const size_t _capacity;
+    size_t _size;
+};
+
+// Generates the rapidjson SAX events of a MessagePack value, so that it can
+// populate a document.
+class Reader final {
+public:
+    Reader(const void *data, size_t length)
+        : _data(static_cast<const uint8_t *>(data)), _end(_data + length) {}
+
+    template <typename Handler>
+    bool operator()(Handler &handler) {
+        return read_value(handler, 0) && _data == _end;
+    }
+
+private:
+    bool get(uint8_t &byte) {
+        if (_data == _end) return false;
+        byte = *_data++;
+        return true;
+    }
+
+    // Reads a big endian value of the given number of bytes.
+    bool get_big_endian(size_t bytes, uint64_t &value) {
+        if (static_cast<size_t>(_end - _data) < bytes) return false;
+        value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value = (value << 8) | *_data++;
+        }
+        return true;
+    }
+
+    bool get_string(size_t length, const char *&str) {
+        if (static_cast<size_t>(_end - _data) < length) return false;
+        str = reinterpret_cast<const char *>(_data);
+        _data += length;
+        return true;
+    }
+
+    // Reads the length of a string, array or map, with the given fixed format
+    // range and the format bytes of its 8, 16 and 32 bit lengths. Returns false
+    // if the format is not of the expected type.
+    bool read_length(uint8_t format, uint8_t fix, uint8_t fix_mask, uint8_t format8,
+                     uint8_t format16, uint8_t format32, size_t &length) {
+        uint64_t value = 0;
+        if ((format & ~fix_mask) == fix) {
+            length = format & fix_mask;
+            return true;
+        }
+        if (format8 != 0 && format == format8) {
+            if (!get_big_endian(1, value)) return false;
+        } else if (format == format16) {
+            if (!get_big_endian(2, value)) return false;
+        } else if (format == format32) {
+            if (!get_big_endian(4, value)) return false;
+        } else {
+            return false;
+        }
+        length = static_cast<size_t>(value);
+        return true;
+    }
+
+    template <typename Handler>
+    bool read_uint(Handler &handler, uint64_t value) {
+        if (value <= UINT32_MAX) return handler.Uint(static_cast<unsigned>(value));
+        return handler.Uint64(value);
+    }
+
+    template <typename Handler>
+    bool read_int(Handler &handler, int64_t value) {
+        if (value >= INT32_MIN && value <= INT32_MAX)
+            return handler.Int(static_cast<int>(value));
+        return handler.Int64(value);
+    }
+
+    template <typename Handler>
+    bool read_value(Handler &handler, size_t depth) {
+        uint8_t format = 0;
+        if (!get(format)) return false;
+
+        if (format <= positive_fixint_max) return handler.Uint(format);
+        if (format >= negative_fixint_min)
+            return handler.Int(static_cast<int8_t>(format));
+
+        size_t length = 0;
+        const char *str = nullptr;
+        uint64_t value = 0;
+        switch (format) {
+            case nil:
+                return handler.Null();
+            case false_value:
+                return handler.Bool(false);
+            case true_value:
+                return handler.Bool(true);
+            case float32: {
+                if (!get_big_endian(4, value)) return false;
+                const uint32_t bits = static_cast<uint32_t>(value);
+                float f = 0;
+                std::memcpy(&f, &bits, sizeof(f));
+                return handler.Double(f);
+            }
+            case float64: {
+                if (!get_big_endian(8, value)) return false;
+                double d = 0;
+                std::memcpy(&d, &value, sizeof(d));
+                return handler.Double(d);
+            }
+            case uint8:
+                return get_big_endian(1, value) && read_uint(handler, value);
+            case uint16:
+                return get_big_endian(2, value) && read_uint(handler, value);
+            case uint32:
+                return get_big_endian(4, value) && read_uint(handler, value);
+            case uint64:
+                return get_big_endian(8, value) && read_uint(handler, value);
+            case int8:
+                return get_big_endian(1, value) &&
+                       read_int(handler, static_cast<int8_t>(value));
+            case int16:
+                return get_big_endian(2, value) &&
+                       read_int(handler, static_cast<int16_t>(value));
+            case int32:
+                return get_big_endian(4, value) &&
+                       read_int(handler, static_cast<int32_t>(value));
+            case int64:
+                return get_big_endian(8, value) &&
+                       read_int(handler, static_cast<int64_t>(value));
+            default:
+                break;
+        }
+
+        if (read_length(format, fixstr, 0x1f, str8, str16, str32, length)) {
+            if (!get_string(length, str)) return false;
+            return handler.String(str, static_cast<rapidjson::SizeType>(length), true);
+        }
+
+        if (depth >= max_depth()) return false;
+
+        if (read_length(format, fixarray, 0x0f, 0, array16, array32, length)) {
+            if (!handler.StartArray()) return false;
+            for (size_t i = 0; i < length; ++i) {
+                if (!read_value(handler, depth + 1)) return false;
+            }
+            return handler.EndArray(static_cast<rapidjson::SizeType>(length));
+        }
+
+        if (read_length(format, fixmap, 0x0f, 0, map16, map32, length)) {
+            if (!handler.StartObject()) return false;
+            for (size_t i = 0; i < length; ++i) {
+                // JSON objects only have string keys.
+                size_t key_length = 0;
+                if (!get(format)) return false;
+                if (!read_length(format, fixstr, 0x1f, str8, str16, str32, key_length) ||
+                    !get_string(key_length, str)) {
+                    return false;
+                }
+                const auto size = static_cast<rapidjson::SizeType>(key_length);
+                if (!handler.Key(str, size, true)) return false;
+                if (!read_value(handler, depth + 1)) return false;
+            }
+            return handler.EndObject(static_cast<rapidjson::SizeType>(length));
+        }
+
+        // Binary, extension and unused formats.
+        return false;
+    }
+
+    const uint8_t *_data;
+    const uint8_t *const _end;
+};
+
+}  // namespace
+
+bool write(const JsonValue &value, void *data, size_t capacity, size_t &length) {
+    Writer writer(data, capacity);
+    writer.write(value);
+    if (writer.overflowed()) {
+        return false;
+    }
+
+    length = writer.size();
+    return true;
+}
+
+bool read(const void *data, size_t length, JsonDocument &document) {
+    Reader reader(data, length);
+    bool is_valid = false;
+    auto generator = [&](JsonDocument &handler) {
+        is_valid = reader(handler);
+        return is_valid;
+    };
+    document.Populate(generator);
+    return is_valid;
+}
+
+}  // namespace msgpack
+}  // namespace one
+}  // namespace i3d
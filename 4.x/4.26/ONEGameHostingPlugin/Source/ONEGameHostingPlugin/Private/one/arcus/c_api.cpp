@@ -10,6 +10,7 @@
 #include <one/arcus/c_platform.h>
 #include <one/arcus/opcode.h>
 #include <one/arcus/server.h>
+#include <one/arcus/server_group.h>
 #include <one/arcus/types.h>
 
 #include <utility>
@@ -24,7 +25,7 @@ OneError array_create(OneArrayPtr *array) {
         return ONE_ERROR_VALIDATION_ARRAY_IS_NULLPTR;
     }
 
-    auto a = allocator::create<Array>();
+    auto a = allocator::create_tagged<Array>(allocator::Tag::handle);
     if (a == nullptr) {
         return ONE_ERROR_ARRAY_ALLOCATION_FAILED;
     }
@@ -435,7 +436,7 @@ OneError object_create(OneObjectPtr *object) {
         return ONE_ERROR_VALIDATION_OBJECT_IS_NULLPTR;
     }
 
-    auto o = allocator::create<Object>();
+    auto o = allocator::create_tagged<Object>(allocator::Tag::handle);
     if (o == nullptr) {
         return ONE_ERROR_OBJECT_ALLOCATION_FAILED;
     }
@@ -815,6 +816,132 @@ OneError server_set_logger(OneServerPtr server, OneLogFn log_cb, void *userdata)
     return ONE_ERROR_NONE;
 }
 
+OneError server_set_tracer(OneServerPtr server, OneTraceFn trace_cb, void *userdata) {
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    Tracer tracer;
+    if (trace_cb != nullptr) {
+        auto wrapper = [trace_cb](void *userdata, TraceStage stage, uint32_t packet_id,
+                                  Opcode code, uint64_t nanoseconds) {
+            trace_cb(userdata, static_cast<OneTraceStage>(stage), packet_id,
+                     static_cast<int>(code), nanoseconds);
+        };
+        tracer.set_callback(wrapper, userdata);
+    }
+
+    auto s = (Server *)(server);
+    return s->set_tracer(tracer);
+}
+
+OneError server_set_msgpack_payloads(OneServerPtr server, bool enabled) {
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    auto s = (Server *)(server);
+    s->set_msgpack_payloads(enabled);
+    return ONE_ERROR_NONE;
+}
+
+OneError server_set_compression_threshold(OneServerPtr server, unsigned int threshold) {
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    auto s = (Server *)(server);
+    s->set_compression_threshold(threshold);
+    return ONE_ERROR_NONE;
+}
+
+OneError server_set_coalescing(OneServerPtr server, OneMessageType type, bool enabled,
+                               unsigned int min_interval_ms) {
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    Opcode code = Opcode::invalid;
+    switch (type) {
+        case ONE_MESSAGE_TYPE_APPLICATION_INSTANCE_STATUS:
+            code = Opcode::application_instance_status;
+            break;
+        case ONE_MESSAGE_TYPE_LIVE_STATE:
+            code = Opcode::live_state;
+            break;
+        case ONE_MESSAGE_TYPE_REVERSE_METADATA:
+            code = Opcode::reverse_metadata;
+            break;
+        default:
+            return ONE_ERROR_VALIDATION_MESSAGE_TYPE_NOT_COALESCABLE;
+    }
+
+    auto s = (Server *)(server);
+    return s->set_coalescing(code, enabled, min_interval_ms);
+}
+
+OneError server_set_incoming_overflow(OneServerPtr server, OneIncomingOverflow policy,
+                                      unsigned int max_messages) {
+    static_assert(ONE_INCOMING_OVERFLOW_COUNT == static_cast<int>(IncomingOverflow::count),
+                  "OneIncomingOverflow must be kept in sync with IncomingOverflow");
+
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    if (policy < 0 || policy >= ONE_INCOMING_OVERFLOW_COUNT) {
+        return ONE_ERROR_VALIDATION_INCOMING_OVERFLOW_IS_INVALID;
+    }
+
+    auto s = (Server *)(server);
+    s->set_incoming_overflow(static_cast<IncomingOverflow>(policy), max_messages);
+    return ONE_ERROR_NONE;
+}
+
+OneError server_set_memory_profile(OneServerPtr server, OneMemoryProfile profile) {
+    static_assert(ONE_MEMORY_PROFILE_COUNT == static_cast<int>(MemoryProfile::count),
+                  "OneMemoryProfile must be kept in sync with MemoryProfile");
+
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    if (profile < 0 || profile >= ONE_MEMORY_PROFILE_COUNT) {
+        return ONE_ERROR_VALIDATION_MEMORY_PROFILE_IS_INVALID;
+    }
+
+    auto s = (Server *)(server);
+    return s->set_memory_profile(static_cast<MemoryProfile>(profile));
+}
+
+OneError server_set_memory_sizes(OneServerPtr server, const OneMemorySizes *sizes) {
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    if (sizes == nullptr) {
+        return ONE_ERROR_VALIDATION_SIZE_IS_NULLPTR;
+    }
+
+    connection::Sizes result;
+    result.stream_size = sizes->stream_size;
+    result.incoming_arena_size = sizes->incoming_arena_size;
+    result.max_messages_in = sizes->incoming_queue_size;
+    result.max_messages_out = sizes->outgoing_queue_size;
+
+    auto s = (Server *)(server);
+    return s->set_memory_sizes(result);
+}
+
+OneError server_set_io_thread(OneServerPtr server, bool enabled) {
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    auto s = (Server *)(server);
+    return s->set_io_thread(enabled);
+}
+
 void server_destroy(OneServerPtr server) {
     if (server == nullptr) {
         return;
@@ -833,6 +960,134 @@ OneError server_update(OneServerPtr server) {
     return s->update();
 }
 
+OneError server_wait(OneServerPtr server, int timeout_ms) {
+    auto s = (Server *)server;
+    if (s == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    return s->wait(timeout_ms);
+}
+
+OneError server_wake(OneServerPtr server) {
+    auto s = (Server *)server;
+    if (s == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    s->wake();
+    return ONE_ERROR_NONE;
+}
+
+OneError server_descriptor(OneServerPtr const server, int *descriptor) {
+    auto s = (Server *)server;
+    if (s == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    if (descriptor == nullptr) {
+        return ONE_ERROR_VALIDATION_RESULT_IS_NULLPTR;
+    }
+
+    return s->descriptor(*descriptor);
+}
+
+OneError server_group_create(OneServerGroupPtr *group) {
+    if (group == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR;
+    }
+
+    auto g = allocator::create<ServerGroup>();
+    if (g == nullptr) {
+        return ONE_ERROR_SERVER_ALLOCATION_FAILED;
+    }
+
+    auto err = g->init();
+    if (is_error(err)) {
+        allocator::destroy<ServerGroup>(g);
+        return err;
+    }
+
+    *group = (OneServerGroupPtr)g;
+    return ONE_ERROR_NONE;
+}
+
+void server_group_destroy(OneServerGroupPtr group) {
+    if (group == nullptr) {
+        return;
+    }
+
+    auto g = (ServerGroup *)(group);
+    allocator::destroy<ServerGroup>(g);
+}
+
+OneError server_group_create_server(OneServerGroupPtr group, unsigned int port,
+                                    OneServerPtr *server) {
+    auto g = (ServerGroup *)group;
+    if (g == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR;
+    }
+
+    if (server == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    auto s = allocator::create<Server>();
+    if (s == nullptr) {
+        return ONE_ERROR_SERVER_ALLOCATION_FAILED;
+    }
+
+    auto err = g->add(*s, port);
+    if (is_error(err)) {
+        allocator::destroy<Server>(s);
+        return err;
+    }
+
+    *server = (OneServerPtr)s;
+    return ONE_ERROR_NONE;
+}
+
+OneError server_group_update(OneServerGroupPtr group) {
+    auto g = (ServerGroup *)group;
+    if (g == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR;
+    }
+
+    return g->update();
+}
+
+OneError server_group_wait(OneServerGroupPtr group, int timeout_ms) {
+    auto g = (ServerGroup *)group;
+    if (g == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR;
+    }
+
+    return g->wait(timeout_ms);
+}
+
+OneError server_group_wake(OneServerGroupPtr group) {
+    auto g = (ServerGroup *)group;
+    if (g == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR;
+    }
+
+    g->wake();
+    return ONE_ERROR_NONE;
+}
+
+OneError server_group_descriptor(OneServerGroupPtr const group, int *descriptor) {
+    auto g = (ServerGroup *)group;
+    if (g == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR;
+    }
+
+    if (descriptor == nullptr) {
+        return ONE_ERROR_VALIDATION_RESULT_IS_NULLPTR;
+    }
+
+    return g->descriptor(*descriptor);
+}
+
 OneError server_status(OneServerPtr const server, OneServerStatus *status) {
     auto s = (Server *)server;
     if (s == nullptr) {
@@ -847,6 +1102,58 @@ OneError server_status(OneServerPtr const server, OneServerStatus *status) {
     return ONE_ERROR_NONE;
 }
 
+OneError server_stats(OneServerPtr const server, OneServerStats *stats) {
+    static_assert(ONE_MESSAGE_TYPE_COUNT == stats::message_type_count(),
+                  "OneMessageType must be kept in sync with stats::MessageType");
+    static_assert(ONE_LANE_COUNT == lane_count(), "OneLane must be kept in sync with Lane");
+
+    auto s = (Server *)server;
+    if (s == nullptr) {
+        return ONE_ERROR_VALIDATION_SERVER_IS_NULLPTR;
+    }
+
+    if (stats == nullptr) {
+        return ONE_ERROR_VALIDATION_RESULT_IS_NULLPTR;
+    }
+
+    Stats result;
+    auto err = s->stats(result);
+    if (is_error(err)) {
+        return err;
+    }
+
+    stats->bytes_received = result.bytes_received;
+    stats->bytes_sent = result.bytes_sent;
+    stats->receive_calls = result.receive_calls;
+    stats->send_calls = result.send_calls;
+    stats->poll_calls = result.poll_calls;
+    for (size_t i = 0; i < stats::message_type_count(); ++i) {
+        stats->messages_received[i] = result.messages_received[i];
+        stats->messages_sent[i] = result.messages_sent[i];
+    }
+    stats->incoming_queue_high_water = result.incoming_queue_high_water;
+    stats->outgoing_queue_high_water = result.outgoing_queue_high_water;
+    for (size_t i = 0; i < lane_count(); ++i) {
+        stats->lane_messages_sent[i] = result.lane_messages_sent[i];
+        stats->lane_bytes_sent[i] = result.lane_bytes_sent[i];
+        stats->lane_queue_high_water[i] = result.lane_queue_high_water[i];
+    }
+    stats->messages_coalesced = result.messages_coalesced;
+    stats->incoming_queue_grows = result.incoming_queue_grows;
+    stats->incoming_read_pauses = result.incoming_read_pauses;
+    stats->incoming_inline_dispatches = result.incoming_inline_dispatches;
+    stats->encode_nanoseconds = result.encode_nanoseconds;
+    stats->decode_nanoseconds = result.decode_nanoseconds;
+    stats->handshakes = result.handshakes;
+    stats->handshake_nanoseconds = result.handshake_nanoseconds;
+    stats->connections = result.connections;
+    stats->callbacks = result.callbacks;
+    stats->callback_nanoseconds = result.callback_nanoseconds;
+    stats->data_releases = result.data_releases;
+    stats->data_released_bytes = result.data_released_bytes;
+    return ONE_ERROR_NONE;
+}
+
 OneError server_set_live_state(OneServerPtr server, int players, int max_players,
                                const char *name, const char *map, const char *mode,
                                const char *version, OneObjectPtr additional_data) {
@@ -1016,6 +1323,35 @@ void allocator_set_realloc(void *(*callback)(void *, unsigned int size)) {
     allocator::set_realloc(wrapper);
 }
 
+void allocator_set_json_chunk_size(unsigned int size) {
+    json::set_arena_chunk_size(size);
+}
+
+void allocator_set_message_retained_capacity(unsigned int size) {
+    messages::set_retained_data_capacity(size);
+}
+
+OneError allocator_stats(OneAllocationTag tag, OneAllocationStats *stats) {
+    static_assert(ONE_ALLOCATION_TAG_COUNT == allocator::tag_count(),
+                  "OneAllocationTag must be kept in sync with allocator::Tag");
+
+    if (tag < 0 || tag >= ONE_ALLOCATION_TAG_COUNT) {
+        return ONE_ERROR_VALIDATION_ALLOCATION_TAG_IS_INVALID;
+    }
+
+    if (stats == nullptr) {
+        return ONE_ERROR_VALIDATION_RESULT_IS_NULLPTR;
+    }
+
+    allocator::TagStats result;
+    allocator::tag_stats(static_cast<allocator::Tag>(tag), result);
+    stats->live_bytes = result.live_bytes;
+    stats->peak_bytes = result.peak_bytes;
+    stats->allocations = result.allocations;
+    stats->frees = result.frees;
+    return ONE_ERROR_NONE;
+}
+
 }  // Unnamed namespace.
 }  // namespace one
 }  // namespace i3d
@@ -1238,6 +1574,41 @@ OneError one_server_set_logger(OneServerPtr server, OneLogFn log_cb, void *userd
     return one::server_set_logger(server, log_cb, userdata);
 }
 
+OneError one_server_set_tracer(OneServerPtr server, OneTraceFn trace_cb, void *userdata) {
+    return one::server_set_tracer(server, trace_cb, userdata);
+}
+
+OneError one_server_set_msgpack_payloads(OneServerPtr server, bool enabled) {
+    return one::server_set_msgpack_payloads(server, enabled);
+}
+
+OneError one_server_set_compression_threshold(OneServerPtr server,
+                                              unsigned int threshold) {
+    return one::server_set_compression_threshold(server, threshold);
+}
+
+OneError one_server_set_coalescing(OneServerPtr server, OneMessageType type,
+                                   bool enabled, unsigned int min_interval_ms) {
+    return one::server_set_coalescing(server, type, enabled, min_interval_ms);
+}
+
+OneError one_server_set_incoming_overflow(OneServerPtr server, OneIncomingOverflow policy,
+                                          unsigned int max_messages) {
+    return one::server_set_incoming_overflow(server, policy, max_messages);
+}
+
+OneError one_server_set_memory_profile(OneServerPtr server, OneMemoryProfile profile) {
+    return one::server_set_memory_profile(server, profile);
+}
+
+OneError one_server_set_memory_sizes(OneServerPtr server, const OneMemorySizes *sizes) {
+    return one::server_set_memory_sizes(server, sizes);
+}
+
+OneError one_server_set_io_thread(OneServerPtr server, bool enabled) {
+    return one::server_set_io_thread(server, enabled);
+}
+
 void one_server_destroy(OneServerPtr server) {
     return one::server_destroy(server);
 }
@@ -1246,10 +1617,55 @@ OneError one_server_update(OneServerPtr server) {
     return one::server_update(server);
 }
 
+OneError one_server_wait(OneServerPtr server, int timeout_ms) {
+    return one::server_wait(server, timeout_ms);
+}
+
+OneError one_server_wake(OneServerPtr server) {
+    return one::server_wake(server);
+}
+
+OneError one_server_descriptor(OneServerPtr const server, int *descriptor) {
+    return one::server_descriptor(server, descriptor);
+}
+
 OneError one_server_status(OneServerPtr const server, OneServerStatus *status) {
     return one::server_status(server, status);
 }
 
+OneError one_server_stats(OneServerPtr const server, OneServerStats *stats) {
+    return one::server_stats(server, stats);
+}
+
+OneError one_server_group_create(OneServerGroupPtr *group) {
+    return one::server_group_create(group);
+}
+
+void one_server_group_destroy(OneServerGroupPtr group) {
+    one::server_group_destroy(group);
+}
+
+OneError one_server_group_create_server(OneServerGroupPtr group, unsigned int port,
+                                        OneServerPtr *server) {
+    return one::server_group_create_server(group, port, server);
+}
+
+OneError one_server_group_update(OneServerGroupPtr group) {
+    return one::server_group_update(group);
+}
+
+OneError one_server_group_wait(OneServerGroupPtr group, int timeout_ms) {
+    return one::server_group_wait(group, timeout_ms);
+}
+
+OneError one_server_group_wake(OneServerGroupPtr group) {
+    return one::server_group_wake(group);
+}
+
+OneError one_server_group_descriptor(OneServerGroupPtr const group, int *descriptor) {
+    return one::server_group_descriptor(group, descriptor);
+}
+
 OneError one_server_set_live_state(OneServerPtr server, int players, int max_players,
                                    const char *name, const char *map, const char *mode,
                                    const char *version, OneObjectPtr additional_data) {
@@ -1313,4 +1729,20 @@ void one_allocator_set_realloc(void *(*callback)(void *, unsigned int size)) {
     one::allocator_set_realloc(callback);
 }
 
+void one_allocator_set_json_chunk_size(unsigned int size) {
+    one::allocator_set_json_chunk_size(size);
+}
+
+void one_allocator_set_message_retained_capacity(unsigned int size) {
+    one::allocator_set_message_retained_capacity(size);
+}
+
+void one_allocator_set_tracking(bool enabled) {
+    one::allocator::set_tracking(enabled);
+}
+
+OneError one_allocator_stats(OneAllocationTag tag, OneAllocationStats *stats) {
+    return one::allocator_stats(tag, stats);
+}
+
 };  // extern "C"
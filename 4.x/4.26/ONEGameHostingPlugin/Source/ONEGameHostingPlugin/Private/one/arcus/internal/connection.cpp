@@ -1,13 +1,16 @@
 // Copyright i3D.net, 2021. All Rights Reserved.
 #include <one/arcus/internal/connection.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <cstring>
 
+#include <one/arcus/allocator.h>
 #include <one/arcus/message.h>
 #include <one/arcus/opcode.h>
 #include <one/arcus/c_platform.h>
 #include <one/arcus/internal/codec.h>
+#include <one/arcus/internal/poller.h>
 #include <one/arcus/internal/socket.h>
 
 #ifdef ONE_WINDOWS
@@ -44,50 +47,348 @@ void log(const Socket &socket, std::function<void(OStringStream &)> cb) {
 }  // namespace
 #endif  // ONE_ARCUS_CONNECTION_LOGGING
 
-Connection::Connection(size_t max_messages_in, size_t max_messages_out)
+namespace connection {
+
+namespace {
+
+const Opcode coalesced_opcodes[coalesced_opcode_count()] = {
+    Opcode::application_instance_status, Opcode::live_state, Opcode::reverse_metadata};
+
+}  // namespace
+
+Opcode coalesced_opcode(size_t index) {
+    assert(index < coalesced_opcode_count());
+    return coalesced_opcodes[index];
+}
+
+size_t coalesced_index(Opcode code) {
+    size_t index = 0;
+    while (index < coalesced_opcode_count() && coalesced_opcodes[index] != code) {
+        ++index;
+    }
+    return index;
+}
+
+bool is_coalesced_by_default(size_t index) {
+    return coalesced_opcode(index) != Opcode::reverse_metadata;
+}
+
+Sizes sizes(MemoryProfile profile) {
+    Sizes sizes;
+    sizes.max_messages_in = Connection::max_message_default;
+    sizes.max_messages_out = Connection::max_message_default;
+    if (profile == MemoryProfile::small) {
+        sizes.stream_size = 1024 * 4;
+        sizes.incoming_arena_size = 1024 * 4;
+    } else {
+        sizes.stream_size = stream_max_size();
+        sizes.incoming_arena_size = 1024 * 64;
+    }
+    return sizes;
+}
+
+bool is_valid(const Sizes &sizes) {
+    return sizes.stream_size >= buffer_min_size() &&
+           sizes.stream_size <= stream_max_size() &&
+           sizes.incoming_arena_size >= buffer_min_size() && sizes.max_messages_in > 0 &&
+           sizes.max_messages_out > 0;
+}
+
+}  // namespace connection
+
+Connection::CoalescedMessage::CoalescedMessage()
+    : is_enabled(false)
+    , is_pending(false)
+    , min_interval_ms(0)
+    , last_sent_nanoseconds(0)
+    , message() {}
+
+Connection::Connection(const connection::Sizes &sizes)
     : _socket(nullptr)
+    , _poller(nullptr)
     , _status(Status::uninitialized)
-    , _in_stream(connection::stream_receive_buffer_size())
-    , _out_stream(connection::stream_send_buffer_size())
-    , _incoming_messages(max_messages_in)
-    , _outgoing_messages(max_messages_out)
+    , _is_waiting_for_writable(false)
+    , _packet_id(1)
+    , _supported_capabilities(codec::capability::none)
+    , _capabilities(codec::capability::none)
+    , _compression_threshold(codec::compression_threshold_default())
+    , _compression_buffer(nullptr)
+    , _is_compression_buffer_shared(false)
+    , _sizes(sizes)
+    , _in_stream(sizes.stream_size, connection::stream_max_size())
+    , _out_stream(sizes.stream_size, connection::stream_max_size())
+    , _incoming_arena_buffer(static_cast<char *>(
+          allocator::alloc(sizes.incoming_arena_size, allocator::Tag::connection)))
+    , _incoming_arena(allocator::create<JsonArena>(
+          _incoming_arena_buffer, sizes.incoming_arena_size, json::arena_chunk_size()))
+    , _incoming_messages(sizes.max_messages_in, _incoming_arena)
+    , _incoming_overflow(IncomingOverflow::pause)
+    , _max_incoming_messages(sizes.max_messages_in)
+    , _incoming_dispatcher(nullptr)
+    , _is_reading_paused(false)
+    , _outgoing_lanes()
+    , _coalesced()
     , _handshake_timer(handshake_timeout_seconds)
     , _health_checker(HealthChecker::health_check_send_interval_seconds,
-                      HealthChecker::health_check_receive_interval_seconds) {
+                      HealthChecker::health_check_receive_interval_seconds)
+    , _stats()
+    , _handshake_start_nanoseconds(0)
+    , _tracer()
+#ifdef ONE_ARCUS_TRACING
+    , _pending_frames()
+    , _sent_bytes(0)
+    , _receive_nanoseconds(0)
+#endif
+{
+    for (size_t i = 0; i < lane_count(); ++i) {
+        const size_t capacity = (static_cast<Lane>(i) == Lane::control)
+                                    ? connection::control_lane_capacity()
+                                    : sizes.max_messages_out;
+        _outgoing_lanes[i] = allocator::create<Ring<Message>>(capacity);
+        assert(_outgoing_lanes[i] != nullptr);
+    }
     _handshake_timer.sync_now();
+    for (size_t i = 0; i < connection::coalesced_opcode_count(); ++i) {
+        _coalesced[i].is_enabled = connection::is_coalesced_by_default(i);
+    }
+}
+
+Connection::~Connection() {
+    // The arena keeps its bookkeeping in the buffer, so it is destroyed first.
+    clear_incoming_messages();
+    allocator::destroy(_incoming_arena);
+    _incoming_arena = nullptr;
+    allocator::free(_incoming_arena_buffer);
+    _incoming_arena_buffer = nullptr;
+    for (auto &lane : _outgoing_lanes) {
+        allocator::destroy(lane);
+        lane = nullptr;
+    }
+    if (_compression_buffer != nullptr && !_is_compression_buffer_shared) {
+        allocator::free(_compression_buffer);
+    }
+    _compression_buffer = nullptr;
 }
 
-void Connection::init(Socket &socket) {
+void Connection::init(Socket &socket, Poller &poller) {
     assert(_status == Status::uninitialized);
     _socket = &socket;
+    _poller = &poller;
+    _is_waiting_for_writable = false;
+    _is_reading_paused = false;
+    _packet_id = 1;
+    _capabilities = codec::capability::none;
     _handshake_timer.sync_now();
     _health_checker.reset_receive_timer();
+    _handshake_start_nanoseconds = stats::now_nanoseconds();
+#ifdef ONE_ARCUS_TRACING
+    _pending_frames.clear();
+    _sent_bytes = 0;
+#endif
     _status = Status::handshake_not_started;
 }
 
 void Connection::shutdown() {
-    _out_stream.clear();
-    _in_stream.clear();
-    _outgoing_messages.clear();
-    _incoming_messages.clear();
+    _out_stream.reset(_sizes.stream_size);
+    _in_stream.reset(_sizes.stream_size);
+    for (auto lane : _outgoing_lanes) {
+        lane->clear();
+    }
+    for (auto &coalesced : _coalesced) {
+        coalesced.is_pending = false;
+        coalesced.last_sent_nanoseconds = 0;
+        coalesced.message.reset();
+    }
+    clear_incoming_messages();
+    // The incoming queue may have grown on overflow.
+    if (_incoming_messages.capacity() != _sizes.max_messages_in) {
+        _incoming_messages.reset(_sizes.max_messages_in, _incoming_arena);
+    }
     _status = Status::uninitialized;
     _socket = nullptr;
+    _poller = nullptr;
+    _is_waiting_for_writable = false;
+    _is_reading_paused = false;
+}
+
+void Connection::set_sizes(const connection::Sizes &sizes) {
+    assert(_status == Status::uninitialized);
+    assert(connection::is_valid(sizes));
+    _out_stream.reset(sizes.stream_size);
+    _in_stream.reset(sizes.stream_size);
+
+    // The queued messages refer to the arena, so a new arena needs new slots.
+    if (sizes.incoming_arena_size != _sizes.incoming_arena_size) {
+        clear_incoming_messages();
+        _incoming_messages.reset(1);
+        allocator::destroy(_incoming_arena);
+        allocator::free(_incoming_arena_buffer);
+        _incoming_arena_buffer = static_cast<char *>(
+            allocator::alloc(sizes.incoming_arena_size, allocator::Tag::connection));
+        _incoming_arena = allocator::create<JsonArena>(
+            _incoming_arena_buffer, sizes.incoming_arena_size, json::arena_chunk_size());
+        _incoming_messages.reset(sizes.max_messages_in, _incoming_arena);
+    } else if (sizes.max_messages_in != _incoming_messages.capacity()) {
+        _incoming_messages.reset(sizes.max_messages_in, _incoming_arena);
+    }
+    _max_incoming_messages = std::max(_max_incoming_messages, sizes.max_messages_in);
+
+    if (sizes.max_messages_out != _sizes.max_messages_out) {
+        for (size_t i = 0; i < lane_count(); ++i) {
+            if (static_cast<Lane>(i) == Lane::control) continue;
+            _outgoing_lanes[i]->reset(sizes.max_messages_out);
+        }
+    }
+    _sizes = sizes;
 }
 
 Connection::Status Connection::status() const {
     return _status;
 }
 
+void Connection::set_coalescing(Opcode code, bool is_enabled,
+                                unsigned int min_interval_ms) {
+    const size_t index = connection::coalesced_index(code);
+    assert(index < connection::coalesced_opcode_count());
+    auto &coalesced = _coalesced[index];
+    coalesced.is_enabled = is_enabled;
+    coalesced.min_interval_ms = min_interval_ms;
+}
+
+int Connection::next_send_delay_ms() const {
+    const uint64_t now = stats::now_nanoseconds();
+    int delay_ms = -1;
+    for (const auto &coalesced : _coalesced) {
+        if (!coalesced.is_pending || coalesced.min_interval_ms == 0) continue;
+
+        const uint64_t due =
+            coalesced.last_sent_nanoseconds + coalesced.min_interval_ms * 1000000ull;
+        // Rounded up, so that the wait does not end just before it is due.
+        const int remaining_ms =
+            (due > now) ? static_cast<int>((due - now + 999999) / 1000000) : 0;
+        if (delay_ms < 0 || remaining_ms < delay_ms) {
+            delay_ms = remaining_ms;
+        }
+    }
+    return delay_ms;
+}
+
 OneError Connection::add_outgoing(const Message &message) {
     if (_status == Status::uninitialized) return ONE_ERROR_CONNECTION_UNINITIALIZED;
 
-    if (_outgoing_messages.size() == _outgoing_messages.capacity())
-        return ONE_ERROR_CONNECTION_OUTGOING_QUEUE_INSUFFICIENT_SPACE;
+    auto slot = coalesced(message);
+    if (slot != nullptr) {
+        slot->message = message;
+        commit_coalesced(*slot);
+        return ONE_ERROR_NONE;
+    }
+
+    auto &lane = *_outgoing_lanes[static_cast<size_t>(lane_of(message.code()))];
+    Message *queued = lane.reserve();
+    if (queued == nullptr) return ONE_ERROR_CONNECTION_OUTGOING_QUEUE_INSUFFICIENT_SPACE;
+
+    *queued = message;
+    commit_outgoing(lane, *queued);
+    return ONE_ERROR_NONE;
+}
+
+OneError Connection::add_outgoing(Message &&message) {
+    if (_status == Status::uninitialized) return ONE_ERROR_CONNECTION_UNINITIALIZED;
+
+    auto slot = coalesced(message);
+    if (slot != nullptr) {
+        slot->message = std::move(message);
+        commit_coalesced(*slot);
+        return ONE_ERROR_NONE;
+    }
 
-    _outgoing_messages.push(message);
+    auto &lane = *_outgoing_lanes[static_cast<size_t>(lane_of(message.code()))];
+    Message *queued = lane.reserve();
+    if (queued == nullptr) return ONE_ERROR_CONNECTION_OUTGOING_QUEUE_INSUFFICIENT_SPACE;
+
+    *queued = std::move(message);
+    commit_outgoing(lane, *queued);
     return ONE_ERROR_NONE;
 }
 
+void Connection::commit_outgoing(Ring<Message> &lane, Message &message) {
+    message.set_packet_id(_packet_id++);
+    lane.commit();
+
+    const size_t index = static_cast<size_t>(lane_of(message.code()));
+    if (lane.size() > _stats.lane_queue_high_water[index]) {
+        _stats.lane_queue_high_water[index] = lane.size();
+    }
+    size_t size = 0;
+    for (auto queued : _outgoing_lanes) {
+        size += queued->size();
+    }
+    if (size > _stats.outgoing_queue_high_water) {
+        _stats.outgoing_queue_high_water = size;
+    }
+    ONE_ARCUS_TRACE(_tracer, enqueue, message);
+}
+
+Connection::CoalescedMessage *Connection::coalesced(const Message &message) {
+    const size_t index = connection::coalesced_index(message.code());
+    if (index == connection::coalesced_opcode_count() || !_coalesced[index].is_enabled) {
+        return nullptr;
+    }
+    return &_coalesced[index];
+}
+
+Connection::CoalescedMessage *Connection::due_coalesced(Lane lane, uint64_t nanoseconds) {
+    for (size_t i = 0; i < connection::coalesced_opcode_count(); ++i) {
+        auto &coalesced = _coalesced[i];
+        if (!coalesced.is_pending || lane_of(connection::coalesced_opcode(i)) != lane) {
+            continue;
+        }
+        if (coalesced.min_interval_ms != 0 && coalesced.last_sent_nanoseconds != 0 &&
+            nanoseconds - coalesced.last_sent_nanoseconds <
+                coalesced.min_interval_ms * 1000000ull) {
+            continue;
+        }
+        return &coalesced;
+    }
+    return nullptr;
+}
+
+void Connection::commit_coalesced(CoalescedMessage &coalesced) {
+    if (coalesced.is_pending) {
+        ++_stats.messages_coalesced;
+    }
+    coalesced.is_pending = true;
+    coalesced.message.set_packet_id(_packet_id++);
+    ONE_ARCUS_TRACE(_tracer, enqueue, coalesced.message);
+}
+
+void Connection::set_incoming_overflow(IncomingOverflow policy, size_t max_messages) {
+    _incoming_overflow = policy;
+    _max_incoming_messages = std::max(max_messages, _incoming_messages.capacity());
+}
+
+void Connection::set_incoming_dispatcher(IncomingDispatcher dispatcher) {
+    _incoming_dispatcher = dispatcher;
+}
+
+bool Connection::has_pending_incoming() const {
+    if (_incoming_messages.size() == _incoming_messages.capacity()) return false;
+    if (_is_reading_paused) return true;
+
+    const size_t size = _in_stream.size();
+    if (size < codec::header_size()) return false;
+    const void *data = nullptr;
+    _in_stream.peek(size, &data);
+    codec::Header header{};
+    // An invalid header is reported by the update reading it.
+    if (is_error(codec::data_to_header(data, codec::header_size(), header))) return true;
+    return size >= codec::header_size() + header.length;
+}
+
+size_t Connection::incoming_arena_capacity() const {
+    return _incoming_arena->Capacity();
+}
+
 OneError Connection::incoming_count(unsigned int &count) const {
     if (_status == Status::uninitialized) return ONE_ERROR_CONNECTION_UNINITIALIZED;
 
@@ -107,10 +408,33 @@ OneError Connection::remove_incoming(
     Message &message = _incoming_messages.pop();
     auto err = read_callback(message);
     message.reset();
+    _stats.count_release(message.release_data(messages::retained_data_capacity()));
+
+    // Queued messages are only decoded when dispatched, so the arena holds
+    // nothing but the payload of the message just released. Recycling it here
+    // keeps it bounded while the peer keeps the queue from emptying.
+    _incoming_arena->Clear();
 
     return err;
 }
 
+void Connection::set_supported_capabilities(char capabilities) {
+    _supported_capabilities = capabilities & codec::capability::all;
+}
+
+void Connection::set_compression_threshold(size_t threshold) {
+    _compression_threshold = threshold;
+}
+
+void Connection::set_compression_buffer(char *buffer) {
+    assert(buffer != nullptr);
+    if (_compression_buffer != nullptr && !_is_compression_buffer_shared) {
+        allocator::free(_compression_buffer);
+    }
+    _compression_buffer = buffer;
+    _is_compression_buffer_shared = true;
+}
+
 OneError Connection::initiate_handshake() {
     if (_status == Status::uninitialized) return ONE_ERROR_CONNECTION_UNINITIALIZED;
     assert(_status == Status::handshake_not_started);
@@ -138,6 +462,7 @@ OneError Connection::update() {
     if (_status == Status::error) return ONE_ERROR_CONNECTION_UPDATE_AFTER_ERROR;
 
     assert(_socket && _socket->is_initialized());
+    assert(_poller != nullptr);
 
     if (_status == Status::ready) {
         auto err = process_health();
@@ -150,12 +475,6 @@ OneError Connection::update() {
     log(*_socket, [&](OStringStream &stream) { stream << "connection update"; });
 #endif
 
-    // Return if socket has no activity or has an error.
-    bool is_ready = false;
-    auto err = _socket->ready_for_send(0.f, is_ready);
-    if (is_error(err)) return err;
-    if (!is_ready) return ONE_ERROR_NONE;
-
     if (_status != Status::ready) return process_handshake();
 
 #ifdef ONE_ARCUS_CONNECTION_LOGGING
@@ -165,17 +484,40 @@ OneError Connection::update() {
 
     // The server mostly replies to client request, so send outgoing messages
     // first.
-    err = process_outgoing_messages();
+    auto err = process_outgoing_messages();
     if (is_error(err)) return err;  // Flush incoming also if error on outgoing?
     return process_incoming_messages();
 }
 
+void Connection::complete_handshake() {
+    _status = Status::ready;
+    ++_stats.handshakes;
+    _stats.handshake_nanoseconds += stats::now_nanoseconds() - _handshake_start_nanoseconds;
+}
+
+OneError Connection::receive_data(void *data, size_t length, size_t &received) {
+    auto err = _socket->receive(data, length, received);
+    ++_stats.receive_calls;
+    _stats.bytes_received += received;
+    return err;
+}
+
+OneError Connection::send_data(const void *data, size_t length, size_t &sent) {
+    auto err = _socket->send(data, length, sent);
+    ++_stats.send_calls;
+    _stats.bytes_sent += sent;
+    return err;
+}
+
 OneError Connection::ensure_nothing_received() {
     assert(_socket && _socket->is_initialized());
 
     char byte;
     size_t received = 0;
-    auto err = _socket->receive(&byte, 1, received);
+    auto err = receive_data(&byte, 1, received);
+    if (err == ONE_ERROR_SOCKET_CLOSED_BY_PEER) {
+        return ONE_ERROR_CONNECTION_CLOSED_BY_PEER;
+    }
     if (is_error(err)) {
         return err;
     }
@@ -194,7 +536,9 @@ OneError Connection::try_send_hello() {
     // send will succeed since it is tiny and partial sends
     // are rare edge cases in general.
     if (stream.size() == 0) {
-        stream.put(&codec::valid_hello(), codec::hello_size());
+        codec::Hello hello = codec::valid_hello();
+        hello.capabilities = _supported_capabilities;
+        stream.put(&hello, codec::hello_size());
     }
 
     // Get remaining buffer.
@@ -206,7 +550,7 @@ OneError Connection::try_send_hello() {
 
     // Send as much as possible.
     size_t sent = 0;
-    auto err = _socket->send(data, size, sent);
+    auto err = send_data(data, size, sent);
     if (is_error(err)) {  // Error.
         return ONE_ERROR_CONNECTION_HELLO_SEND_FAILED;
     }
@@ -216,6 +560,7 @@ OneError Connection::try_send_hello() {
     stream.trim(sent);
     if (stream.size() > 0) return ONE_ERROR_CONNECTION_TRY_AGAIN;
 
+    ++_stats.messages_sent[stats::message_type_index(Opcode::hello)];
     return ONE_ERROR_NONE;
 }
 
@@ -228,12 +573,16 @@ OneError Connection::try_receive_hello() {
     // C++11 Value initialization
     codec::Hello hello{};
     size_t received = 0;
-    auto err = _socket->receive(&hello, codec::hello_size(), received);
+    auto err = receive_data(&hello, codec::hello_size(), received);
+    if (err == ONE_ERROR_SOCKET_CLOSED_BY_PEER) {
+        return ONE_ERROR_CONNECTION_CLOSED_BY_PEER;
+    }
     if (is_error(err)) {
         return ONE_ERROR_CONNECTION_HELLO_RECEIVE_FAILED;
     }
-    if (received == 0) {                        // No error but nothing received.
-        return ONE_ERROR_CONNECTION_TRY_AGAIN;  // Retry next attempt.
+    // The readiness reported by the poller may be spurious.
+    if (received == 0) {
+        return ONE_ERROR_CONNECTION_TRY_AGAIN;
     }
     if (received > codec::hello_size()) {
         return ONE_ERROR_CONNECTION_HELLO_TOO_BIG;
@@ -255,18 +604,27 @@ OneError Connection::try_receive_hello() {
     if (!codec::validate_hello(*data)) {
         return ONE_ERROR_CONNECTION_HELLO_INVALID;
     }
+
+    // Accept the offered capabilities that are supported.
+    _capabilities = data->capabilities & _supported_capabilities;
+    ++_stats.messages_received[stats::message_type_index(Opcode::hello)];
     return ONE_ERROR_NONE;
 }
 
+namespace {
+
 // There are two hello packets. The initial codec::hello sent from the
 // handshake initiater, and the response codec::Header message with a
-// hello opcode sent in response. This is the response header.
+// hello opcode sent in response. This is the response header, without
+// accepted capabilities. It is constant initialized so that it can be shared
+// by connections on any thread.
+const codec::Header hello_message_header{0, static_cast<char>(Opcode::hello), {0, 0}, 0,
+                                         0};
+
+}  // namespace
+
 const codec::Header &hello_message() {
-    // See: https://en.cppreference.com/w/cpp/language/value_initialization
-    // C++11 Value initialization
-    static codec::Header message{};
-    message.opcode = static_cast<char>(Opcode::hello);
-    return message;
+    return hello_message_header;
 }
 
 OneError Connection::try_send_hello_message() {
@@ -278,7 +636,9 @@ OneError Connection::try_send_hello_message() {
     // will succeed since it is tiny and partial sends are rare edge cases in
     // general.
     if (stream.size() == 0) {
-        stream.put(&hello_message(), codec::header_size());
+        codec::Header header = hello_message();
+        header.flags = _capabilities;
+        stream.put(&header, codec::header_size());
     }
 
     // Get remaining buffer.
@@ -290,7 +650,7 @@ OneError Connection::try_send_hello_message() {
 
     // Send.
     size_t sent = 0;
-    auto err = _socket->send(data, size, sent);
+    auto err = send_data(data, size, sent);
     if (is_error(err)) {
         return ONE_ERROR_CONNECTION_HELLO_MESSAGE_SEND_FAILED;
     }
@@ -300,20 +660,32 @@ OneError Connection::try_send_hello_message() {
     stream.trim(sent);
     if (stream.size() > 0) return ONE_ERROR_CONNECTION_TRY_AGAIN;
 
+    ++_stats.messages_sent[stats::message_type_index(Opcode::hello)];
     return ONE_ERROR_NONE;
 }
 
-OneError Connection::try_read_data_into_in_stream() {
+OneError Connection::try_read_data_into_in_stream(bool &is_drained) {
     assert(_socket && _socket->is_initialized());
 
-    constexpr size_t max_read_size = codec::header_size() + codec::payload_max_size();
-    static std::array<char, max_read_size> buffer;
-    const size_t available_size = _in_stream.capacity() - _in_stream.size();
-    const size_t read_size =
-        (max_read_size > available_size) ? available_size : max_read_size;
+    // Receive directly into the free space of the stream.
+    void *buffer = nullptr;
+    size_t read_size = 0;
+    _in_stream.reserve(&buffer, read_size);
+    // A full stream holds the start of a frame larger than it.
+    if (read_size == 0) {
+        if (!_in_stream.grow()) {
+            _status = Status::error;
+            return ONE_ERROR_CONNECTION_READ_TOO_BIG_FOR_STREAM;
+        }
+        _in_stream.reserve(&buffer, read_size);
+    }
 
     size_t received = 0;
-    auto err = _socket->receive(buffer.data(), read_size, received);
+    auto err = receive_data(buffer, read_size, received);
+    if (err == ONE_ERROR_SOCKET_CLOSED_BY_PEER) {
+        _status = Status::error;
+        return ONE_ERROR_CONNECTION_CLOSED_BY_PEER;
+    }
     if (is_error(err)) {
         _status = Status::error;
         return ONE_ERROR_CONNECTION_MESSAGE_RECEIVE_FAILED;
@@ -325,22 +697,22 @@ OneError Connection::try_read_data_into_in_stream() {
     });
 #endif
 
-    if (received > _in_stream.capacity() - _in_stream.size()) {
+    if (received > read_size) {
         _status = Status::error;
         return ONE_ERROR_CONNECTION_READ_TOO_BIG_FOR_STREAM;
     }
 
+    // Nothing more to read for now.
+    if (received == 0) return ONE_ERROR_CONNECTION_TRY_AGAIN;
+
+    // A short read means the socket has been emptied.
+    is_drained = received < read_size;
+
     // Buffer bytes read.
-    _in_stream.put(buffer.data(), received);
-    if (_in_stream.size() < codec::header_size()) {
-#ifdef ONE_ARCUS_CONNECTION_LOGGING
-        log(*_socket, [&](OStringStream &stream) {
-            stream << "stream size smaller than header size: " << _in_stream.size();
-        });
+    _in_stream.commit(received);
+#ifdef ONE_ARCUS_TRACING
+    _receive_nanoseconds = stats::now_nanoseconds();
 #endif
-        return ONE_ERROR_CONNECTION_TRY_AGAIN;
-    }
-
     return ONE_ERROR_NONE;
 }
 
@@ -357,7 +729,9 @@ OneError Connection::try_read_message_from_in_stream(codec::Header &header,
 
     // Attempt to read a message from it.
     size_t size_read = 0;
+    const uint64_t decode_start = stats::now_nanoseconds();
     auto err = codec::data_to_message(data, in_stream_size, size_read, header, message);
+    _stats.decode_nanoseconds += stats::now_nanoseconds() - decode_start;
     if (is_error(err)) {
         if (err == ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_PAYLOAD) {
             // More reading is needed to be able to read the entire payload.
@@ -366,6 +740,13 @@ OneError Connection::try_read_message_from_in_stream(codec::Header &header,
         return err;
     }
     _in_stream.trim(size_read);
+    message.set_packet_id(header.packet_id);
+    ++_stats.messages_received[stats::message_type_index(message.code())];
+#ifdef ONE_ARCUS_TRACING
+    _tracer.trace_at(TraceStage::receive, message.packet_id(), message.code(),
+                     _receive_nanoseconds);
+    ONE_ARCUS_TRACE(_tracer, header_decode, message);
+#endif
 
 #ifdef ONE_ARCUS_CONNECTION_LOGGING
     log(*_socket, [&](OStringStream &stream) {
@@ -377,7 +758,8 @@ OneError Connection::try_read_message_from_in_stream(codec::Header &header,
 }
 
 OneError Connection::try_receive_hello_message() {
-    auto err = try_read_data_into_in_stream();
+    bool is_drained = false;
+    auto err = try_read_data_into_in_stream(is_drained);
     if (is_error(err)) return err;
 
     // See: https://en.cppreference.com/w/cpp/language/value_initialization
@@ -387,13 +769,31 @@ OneError Connection::try_receive_hello_message() {
     err = try_read_message_from_in_stream(header, message);
     if (is_error(err)) return err;
 
+    // The flags hold the accepted capabilities, which must have been offered.
+    const char accepted = header.flags;
+    if ((accepted & ~_supported_capabilities) != 0)
+        return ONE_ERROR_CONNECTION_HELLO_MESSAGE_REPLY_INVALID;
+    header.flags = 0;
     if (std::memcmp(&header, &hello_message(), codec::header_size()) != 0)
         return ONE_ERROR_CONNECTION_HELLO_MESSAGE_REPLY_INVALID;
     if (!message.payload().is_empty())
         return ONE_ERROR_CONNECTION_HELLO_MESSAGE_REPLY_INVALID;
+
+    _capabilities = accepted;
     return ONE_ERROR_NONE;
 }
 
+void Connection::clear_incoming_messages() {
+    // The payloads are reset before the arena they are allocated from is
+    // cleared.
+    while (_incoming_messages.size() > 0) {
+        Message &message = _incoming_messages.pop();
+        message.reset();
+        _stats.count_release(message.release_data(messages::retained_data_capacity()));
+    }
+    _incoming_arena->Clear();
+}
+
 OneError Connection::process_handshake() {
     assert(_socket && _socket->is_initialized());
 
@@ -408,19 +808,15 @@ OneError Connection::process_handshake() {
         return err;
     };
 
+    const bool is_readable = _poller->is_readable(*_socket);
+
     switch (_status) {
         case Status::handshake_not_started:
             // Check if hello received.
+            if (!is_readable) break;
             err = try_receive_hello();
             if (err == ONE_ERROR_CONNECTION_TRY_AGAIN) break;
             if (is_error(err)) return fail(err);
-
-            {
-                bool is_ready = false;
-                err = _socket->ready_for_send(0.f, is_ready);
-                if (is_error(err)) return err;
-                if (!is_ready) break;
-            }
             // Fallthrough.
         case Status::handshake_hello_received:
             err = try_send_hello_message();
@@ -429,13 +825,15 @@ OneError Connection::process_handshake() {
             // Assume handshaking is complete now. This side is free to send other
             // Messages now. If handshaking fails on the server, then the connection
             // will be closed and the Messages will be ignored.
-            _status = Status::ready;
+            complete_handshake();
             break;
         case Status::handshake_hello_scheduled:
             // Ensure nothing is received. Arcus client should not send
             // until it receives a Hello.
-            err = ensure_nothing_received();
-            if (is_error(err)) return fail(err);
+            if (is_readable) {
+                err = ensure_nothing_received();
+                if (is_error(err)) return fail(err);
+            }
 
             // Send the hello.
             err = try_send_hello();
@@ -445,10 +843,11 @@ OneError Connection::process_handshake() {
             _status = Status::handshake_hello_sent;
             break;
         case Status::handshake_hello_sent:
+            if (!is_readable) break;
             err = try_receive_hello_message();
             if (err == ONE_ERROR_CONNECTION_TRY_AGAIN) break;
             if (is_error(err)) return fail(err);
-            _status = Status::ready;
+            complete_handshake();
             break;
         default:
             _status = Status::error;
@@ -461,35 +860,85 @@ OneError Connection::process_handshake() {
 OneError Connection::process_incoming_messages() {
     assert(_socket && _socket->is_initialized());
 
+    bool is_readable = _poller->is_readable(*_socket);
+
+    // Reading resumes once messages have been removed from the full queue.
+    // The socket was not watched meanwhile, so it is read without knowing
+    // whether data is pending.
+    if (_is_reading_paused) {
+        if (_incoming_messages.size() == _incoming_messages.capacity()) {
+            return ONE_ERROR_NONE;
+        }
+        auto err = pause_reading(false);
+        if (is_error(err)) {
+            _status = Status::error;
+            return err;
+        }
+        is_readable = true;
+    }
+
+    // Nothing new was received and there is no complete message left over
+    // in the stream.
+    if (!is_readable && _in_stream.size() < codec::header_size()) {
+        return ONE_ERROR_NONE;
+    }
+
     // See: https://en.cppreference.com/w/cpp/language/value_initialization
     // C++11 Value initialization
     codec::Header header{};
-    Message message;
+    // Messages are decoded directly into the next free slot of the incoming
+    // queue. Once it is full, the overflow policy makes room or pauses
+    // reading. With the error policy, they are decoded into the overflow
+    // message so that health messages are still consumed.
+    Message overflow;
+    Message *message = nullptr;
     auto err = ONE_ERROR_NONE;
+    bool is_drained = !is_readable;
 
     // Attempts to get data to process from the socket. Sets the above error if an error
     // is encountered.
     auto get_data_and_continue = [&]() -> bool {
-        err = try_read_data_into_in_stream();
+        // Once the socket has been emptied, any data arriving after it is
+        // reported by the next poll, saving a receive call that would fail
+        // with EAGAIN.
+        if (is_drained) return false;
+
+        err = try_read_data_into_in_stream(is_drained);
         if (err == ONE_ERROR_CONNECTION_TRY_AGAIN) {
             err = ONE_ERROR_NONE;
             return false;
         }
-        if (is_error(err)) return false;
-
-        return true;
+        return !is_error(err);
     };
 
     // Attempts to read message from the incoming data stream and returns
     // true if successful. Sets the above error if an error is encountered.
     auto read_message_and_continue = [&]() -> bool {
-        err = try_read_message_from_in_stream(header, message);
+        message = _incoming_messages.reserve();
+        if (message == nullptr) {
+            if (_incoming_overflow == IncomingOverflow::error) {
+                message = &overflow;
+            } else if (make_incoming_room(err)) {
+                message = _incoming_messages.reserve();
+            } else {
+                if (!is_error(err)) err = pause_reading(true);
+                return false;
+            }
+        }
+
+        err = try_read_message_from_in_stream(header, *message);
         if (err == ONE_ERROR_CONNECTION_TRY_AGAIN) {
             err = ONE_ERROR_NONE;
             return false;
         }
         if (is_error(err)) return false;
 
+        // Payload encodings must have been negotiated during the handshake.
+        if ((header.flags & ~_capabilities) != 0) {
+            err = ONE_ERROR_CODEC_INVALID_HEADER;
+            return false;
+        }
+
         // At this point data has been received from the remote end so update
         // health timer.
         _health_checker.reset_receive_timer();
@@ -497,29 +946,74 @@ OneError Connection::process_incoming_messages() {
         return true;
     };
 
-    while (get_data_and_continue()) {
+    // Consume any complete messages already buffered before reading more.
+    do {
         while (read_message_and_continue()) {
             // Skip health messages, they are consumed internally and do not
             // make it to the queue for public consumption.
-            if (message.code() == Opcode::health) {
+            if (message->code() == Opcode::health) {
                 continue;
             }
 
-            if (_incoming_messages.size() == _incoming_messages.capacity()) {
+            if (message == &overflow) {
                 return ONE_ERROR_CONNECTION_INCOMING_QUEUE_INSUFFICIENT_SPACE;
             }
 
             // Store in incoming queue for consumption.
-            _incoming_messages.push(message);
+            _incoming_messages.commit();
+            if (_incoming_messages.size() > _stats.incoming_queue_high_water) {
+                _stats.incoming_queue_high_water = _incoming_messages.size();
+            }
+            ONE_ARCUS_TRACE(_tracer, enqueue, *message);
         }
-        if (is_error(err)) break;
-    }
+        if (is_error(err) || _is_reading_paused) break;
+    } while (get_data_and_continue());
 
-    if (is_error(err)) _status = Status::error;
+    // A dispatched callback may have shut the connection down.
+    if (is_error(err) && _status != Status::uninitialized) _status = Status::error;
 
     return err;
 }
 
+bool Connection::make_incoming_room(OneError &err) {
+    switch (_incoming_overflow) {
+        case IncomingOverflow::grow: {
+            const size_t capacity = _incoming_messages.capacity();
+            if (capacity >= _max_incoming_messages) return false;
+
+            _incoming_messages.grow(std::min(capacity * 2, _max_incoming_messages));
+            ++_stats.incoming_queue_grows;
+            return true;
+        }
+        case IncomingOverflow::dispatch:
+            if (!_incoming_dispatcher) return false;
+
+            ++_stats.incoming_inline_dispatches;
+            err = remove_incoming(_incoming_dispatcher);
+            if (is_error(err)) return false;
+            if (_status != Status::ready) {
+                err = ONE_ERROR_CONNECTION_UNINITIALIZED;
+                return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+OneError Connection::pause_reading(bool is_paused) {
+    if (is_paused == _is_reading_paused) return ONE_ERROR_NONE;
+
+    auto err = _poller->set_read_interest(*_socket, !is_paused);
+    if (is_error(err)) return err;
+
+    _is_reading_paused = is_paused;
+    if (is_paused) {
+        ++_stats.incoming_read_pauses;
+    }
+    return ONE_ERROR_NONE;
+}
+
 OneError Connection::process_outgoing_messages() {
     assert(_socket && _socket->is_initialized());
 
@@ -529,88 +1023,189 @@ OneError Connection::process_outgoing_messages() {
         size_t size = _out_stream.size();
         if (size == 0) return ONE_ERROR_NONE;
 
-        // Check is socket is connected and ready.
-        bool can_send = false;
-        auto err = _socket->ready_for_send(0.f, can_send);
-        if (is_error(err)) return err;
-        if (!can_send) return ONE_ERROR_NONE;
+        // A previous send was blocked, wait until the poller reports the
+        // socket as writable again.
+        if (_is_waiting_for_writable && !_poller->is_writable(*_socket)) {
+            return ONE_ERROR_NONE;
+        }
 
         // Try to send pending data.
         void *data;
         _out_stream.peek(size, &data);
         size_t sent = 0;
-        err = _socket->send(data, size, sent);
+        auto err = send_data(data, size, sent);
         if (err == ONE_ERROR_CONNECTION_TRY_AGAIN) return ONE_ERROR_NONE;
         if (is_error(err)) return err;
 
-        _out_stream.trim(size);
+        _out_stream.trim(sent);
+
+#ifdef ONE_ARCUS_TRACING
+        _sent_bytes += sent;
+        size_t completed = 0;
+        for (; completed < _pending_frames.size(); ++completed) {
+            const auto &frame = _pending_frames[completed];
+            if (frame.end > _sent_bytes) break;
+            _tracer.trace(TraceStage::send_complete, frame.packet_id, frame.code);
+        }
+        _pending_frames.erase(_pending_frames.begin(),
+                              _pending_frames.begin() + completed);
+#endif
 
 #ifdef ONE_ARCUS_CONNECTION_LOGGING
         log(*_socket,
             [&](OStringStream &stream) { stream << "connection sent data: " << sent; });
 #endif
 
+        // Only watch for writability while the socket is unable to accept
+        // all the data.
+        const bool is_blocked = _out_stream.size() > 0;
+        if (is_blocked != _is_waiting_for_writable) {
+            err = _poller->set_write_interest(*_socket, is_blocked);
+            if (is_error(err)) return err;
+            _is_waiting_for_writable = is_blocked;
+        }
+
         return ONE_ERROR_NONE;
     };
 
-    // Send from outgoing buffer if any previous messages are not finished
-    // sending.
-    auto err = send_pending_data();
-    if (is_error(err)) return err;
-
 #ifdef ONE_ARCUS_CONNECTION_LOGGING
     log(*_socket, [&](OStringStream &stream) {
-        stream << "processing outgoing messages: " << _outgoing_messages.size();
+        stream << "processing outgoing messages:";
+        for (auto lane : _outgoing_lanes) {
+            stream << " " << lane->size();
+        }
     });
 #endif
 
-    // Attempt to send all pending messages.
-    while (_outgoing_messages.size() > 0) {
-        // Convert to data payload and add to outgoing buffer.
-        auto message = _outgoing_messages.pop();
+    auto fail = [&](OneError err) {
+        _status = Status::error;
+        return err;
+    };
 
-        auto fail = [&](OneError err) {
-            _status = Status::error;
-            return err;
-        };
+    // Encode the pending messages into the outgoing stream, behind any data
+    // not yet sent by a previous update. A message stays queued if the stream
+    // does not have room for it.
+    const bool is_compressing = (_capabilities & codec::capability::compression) != 0 &&
+                                _compression_threshold != 0;
+    if (is_compressing && _compression_buffer == nullptr) {
+        _compression_buffer =
+            static_cast<char *>(allocator::alloc(codec::payload_max_size(),
+                                                 allocator::Tag::connection));
+    }
+    const auto options =
+        codec::encode_options(_capabilities, _compression_threshold, _compression_buffer);
+
+    while (true) {
+        // The lanes are encoded in priority order, a frame at a time. Below
+        // the control lane, encoding stops at the watermark, so that control
+        // messages queued meanwhile are not sent behind more data.
+        const uint64_t encode_start = stats::now_nanoseconds();
+        bool has_encoded = false;
+        bool is_full = false;
+        bool is_held = false;
+        for (size_t i = 0; i < lane_count() && !is_full && !is_held; ++i) {
+            const Lane lane = static_cast<Lane>(i);
+            auto &messages = *_outgoing_lanes[i];
+            while (true) {
+                if (lane != Lane::control &&
+                    _out_stream.size() >= connection::lane_send_watermark()) {
+                    is_held = true;
+                    break;
+                }
+
+                // The coalesced messages of the lane follow its queued ones,
+                // once their interval has elapsed.
+                CoalescedMessage *coalesced = nullptr;
+                const Message *message = messages.peek();
+                if (message == nullptr) {
+                    coalesced = due_coalesced(lane, encode_start);
+                    if (coalesced == nullptr) break;
+                    message = &coalesced->message;
+                }
+
+                auto err = encode_outgoing(*message, options, is_full);
+                if (is_error(err)) {
+                    return fail(err);
+                }
+                if (is_full) {
+                    break;
+                }
+
+                has_encoded = true;
+                if (coalesced != nullptr) {
+                    coalesced->is_pending = false;
+                    coalesced->last_sent_nanoseconds = encode_start;
+                    coalesced->message.reset();
+                } else {
+                    messages.pop();
+                }
+            }
+        }
 
-        size_t message_size = 0;
-        static uint32_t packet_id = 1;
-        static std::array<char, codec::header_size() + codec::payload_max_size()>
-            out_message_buffer;
-        err =
-            codec::message_to_data(packet_id, message, message_size, out_message_buffer);
+        if (has_encoded) {
+            _stats.encode_nanoseconds += stats::now_nanoseconds() - encode_start;
+        }
 
+        // Flush everything with a single send.
+        auto err = send_pending_data();
         if (is_error(err)) {
             return fail(err);
         }
 
-        const size_t max_size = _out_stream.capacity() - _out_stream.size();
-
-        // If it doesn't fit, then put the the connection into an error state.
-        if (message_size > max_size) {
-            return fail(ONE_ERROR_CONNECTION_OUT_MESSAGE_TOO_BIG_FOR_STREAM);
+        // Encode the held messages, or the one that did not fit, if the
+        // socket took all the data.
+        if ((!is_held && !is_full) || _out_stream.size() > 0) {
+            break;
         }
+    }
 
-        _out_stream.put(out_message_buffer.data(), message_size);
-
-        // Incrementing packet_id only after the message has been queued.
-        ++packet_id;
+    return ONE_ERROR_NONE;
+}
 
-        err = send_pending_data();
-        if (err == ONE_ERROR_CONNECTION_TRY_AGAIN) return ONE_ERROR_NONE;
-        if (is_error(err)) {
-            return fail(err);
+OneError Connection::encode_outgoing(const Message &message,
+                                     const codec::EncodeOptions &options, bool &is_full) {
+    // Encode directly into the free space of the stream.
+    void *data = nullptr;
+    size_t capacity = 0;
+    size_t message_size = 0;
+    OneError err = ONE_ERROR_NONE;
+    while (true) {
+        _out_stream.reserve(&data, capacity);
+        err = codec::message_to_data(message.packet_id(), message, options, data, capacity,
+                                     message_size);
+        if (err != ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_PAYLOAD) break;
+
+        if (_out_stream.size() > 0) {
+            // Retry once pending data has been sent.
+            is_full = true;
+            return ONE_ERROR_NONE;
         }
+        // A message that doesn't fit in an empty stream of the largest size is
+        // reported as too big by the codec.
+        if (!_out_stream.grow()) break;
+    }
+    if (is_error(err)) {
+        return err;
+    }
+
+    _out_stream.commit(message_size);
+#ifdef ONE_ARCUS_TRACING
+    ONE_ARCUS_TRACE(_tracer, encode, message);
+    _pending_frames.push_back(
+        {message.packet_id(), message.code(), _sent_bytes + _out_stream.size()});
+#endif
 
 #ifdef ONE_ARCUS_CONNECTION_LOGGING
-        log(*_socket, [&](OStringStream &stream) {
-            stream << "connection sent message opcode: " << (int)message.code();
-            stream << "message payload" << message.payload().to_json();
-        });
+    log(*_socket, [&](OStringStream &stream) {
+        stream << "connection queued message opcode: " << (int)message.code();
+        stream << "message payload" << message.payload_json();
+    });
 #endif
-    }
 
+    ++_stats.messages_sent[stats::message_type_index(message.code())];
+    const size_t lane = static_cast<size_t>(lane_of(message.code()));
+    ++_stats.lane_messages_sent[lane];
+    _stats.lane_bytes_sent[lane] += message_size;
     return ONE_ERROR_NONE;
 }
 
@@ -0,0 +1,48 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <stddef.h>
+
+#include <one/arcus/opcode.h>
+
+namespace i3d {
+namespace one {
+
+// Classes of outgoing messages, each queued in its own lane of the connection.
+// The lanes are sent in this order of priority, so that the health checks and
+// status changes are not delayed by large payloads. Note these MUST be kept in
+// sync with OneLane in c_api.h.
+enum class Lane {
+    // Health checks, soft stops and status changes.
+    control = 0,
+    // Live state, allocation and information messages.
+    state,
+    // Metadata and custom commands, whose payloads may be large.
+    bulk,
+    count
+};
+
+constexpr size_t lane_count() {
+    return static_cast<size_t>(Lane::count);
+}
+
+// The lane of the outgoing messages of the given opcode.
+inline Lane lane_of(Opcode code) {
+    switch (code) {
+        case Opcode::health:
+        case Opcode::hello:
+        case Opcode::soft_stop:
+        case Opcode::application_instance_status:
+            return Lane::control;
+        case Opcode::live_state:
+        case Opcode::allocated:
+        case Opcode::host_information:
+        case Opcode::application_instance_information:
+            return Lane::state;
+        default:
+            return Lane::bulk;
+    }
+}
+
+}  // namespace one
+}  // namespace i3d
@@ -2,26 +2,80 @@
 #include <one/arcus/message.h>
 
 #include <one/arcus/array.h>
-#include <one/arcus/internal/rapidjson/stringbuffer.h>
-#include <one/arcus/internal/rapidjson/writer.h>
+#include <one/arcus/internal/msgpack.h>
 #include <one/arcus/opcode.h>
 #include <one/arcus/object.h>
 
+#include <assert.h>
+
 namespace i3d {
 namespace one {
 
-Payload::Payload() : _doc(rapidjson::kObjectType) {}
+namespace {
+
+constexpr size_t retained_data_capacity_default = 4 * 1024;
+size_t _retained_data_capacity = retained_data_capacity_default;
+
+}  // namespace
+
+Payload::Payload()
+    : _allocator()
+    , _doc(rapidjson::kObjectType, &_allocator, json::stack_capacity(), &_allocator) {}
+
+Payload::Payload(JsonArena *arena)
+    : _allocator(arena)
+    , _doc(rapidjson::kObjectType, &_allocator, json::stack_capacity(), &_allocator) {}
 
-Payload::Payload(const Payload &other) {
-    _doc.CopyFrom(other._doc, _doc.GetAllocator());
+// Const strings are copied since they refer to the data of an in place parse.
+Payload::Payload(const Payload &other)
+    : _allocator()
+    , _doc(rapidjson::kObjectType, &_allocator, json::stack_capacity(), &_allocator) {
+    _doc.CopyFrom(other._doc, _doc.GetAllocator(), true);
 }
 
 Payload &Payload::operator=(const Payload &other) {
-    _doc.CopyFrom(other._doc, _doc.GetAllocator());
+    if (this == &other) {
+        return *this;
+    }
+
+    clear();
+    _doc.CopyFrom(other._doc, _doc.GetAllocator(), true);
+    return *this;
+}
+
+// The constructed payload allocates from its own pool, so the values of
+// an arena are copied, since they must not outlive it.
+Payload::Payload(Payload &&other)
+    : _allocator()
+    , _doc(rapidjson::kObjectType, &_allocator, json::stack_capacity(), &_allocator) {
+    if (other._allocator.arena() != nullptr) {
+        _doc.CopyFrom(other._doc, _doc.GetAllocator(), true);
+        return;
+    }
+
+    _doc.JsonValue::Swap(other._doc);
+    _allocator.swap(other._allocator);
+}
+
+Payload &Payload::operator=(Payload &&other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    // The root values are swapped along with the pools they are allocated
+    // from. Values of another arena must not outlive it, so they are copied.
+    if (_allocator.arena() != other._allocator.arena()) {
+        return *this = other;
+    }
+
+    _doc.JsonValue::Swap(other._doc);
+    _allocator.swap(other._allocator);
+    other.clear();
     return *this;
 }
 
 OneError Payload::from_json(std::pair<const char *, size_t> data) {
+    clear();
     rapidjson::ParseResult ok = _doc.Parse(data.first, data.second);
     if (!ok) {
         return ONE_ERROR_PAYLOAD_PARSE_FAILED;
@@ -30,9 +84,28 @@ OneError Payload::from_json(std::pair<const char *, size_t> data) {
     return ONE_ERROR_NONE;
 }
 
+OneError Payload::from_json_insitu(char *data) {
+    clear();
+    rapidjson::ParseResult ok = _doc.ParseInsitu(data);
+    if (!ok) {
+        return ONE_ERROR_PAYLOAD_PARSE_FAILED;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+OneError Payload::from_msgpack(std::pair<const char *, size_t> data) {
+    clear();
+    if (!msgpack::read(data.first, data.second, _doc)) {
+        return ONE_ERROR_PAYLOAD_PARSE_FAILED;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
 String Payload::to_json() const {
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    JsonStringBuffer buffer;
+    JsonWriter<JsonStringBuffer> writer(buffer);
     _doc.Accept(writer);
     return String(buffer.GetString(), buffer.GetSize());
 }
@@ -41,8 +114,10 @@ bool Payload::is_empty() const {
     return _doc.ObjectEmpty();
 }
 
+// The values are dropped before the pool they are allocated from is released.
 void Payload::clear() {
     _doc.SetObject();
+    _allocator.release();
 }
 
 bool Payload::is_val_bool(const char *key) const {
@@ -217,7 +292,7 @@ OneError Payload::set_val_bool(const char *key, bool val) {
 
     // Adding key if it does not exists already.
     if (value == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(), val,
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(), val,
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -240,7 +315,7 @@ OneError Payload::set_val_int(const char *key, int val) {
 
     // Adding key if it does not exists already.
     if (value == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(), val,
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(), val,
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -263,8 +338,8 @@ OneError Payload::set_val_string(const char *key, const String &val) {
 
     // Adding key if it does not exists already.
     if (value == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(),
-                       rapidjson::Value(val.c_str(), _doc.GetAllocator()).Move(),
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(),
+                       JsonValue(val.c_str(), _doc.GetAllocator()).Move(),
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -287,8 +362,8 @@ OneError Payload::set_val_array(const char *key, const Array &val) {
 
     // Adding key if it does not exists already.
     if (value == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(),
-                       rapidjson::Value(val.get(), _doc.GetAllocator()).Move(),
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(),
+                       JsonValue(val.get(), _doc.GetAllocator()).Move(),
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -311,8 +386,8 @@ OneError Payload::set_val_object(const char *key, const Object &val) {
 
     // Adding key if it does not exists already.
     if (value == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(),
-                       rapidjson::Value(val.get(), _doc.GetAllocator()).Move(),
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(),
+                       JsonValue(val.get(), _doc.GetAllocator()).Move(),
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -331,43 +406,187 @@ OneError Payload::set_val_root_object(const Object &val) {
         return ONE_ERROR_PAYLOAD_WRONG_TYPE_IS_EXPECTING_OBJECT;
     }
 
+    clear();
     _doc.CopyFrom(val.get(), _doc.GetAllocator());
     return ONE_ERROR_NONE;
 }
 
-Message::Message() : _code(Opcode::invalid) {}
+Message::Message()
+    : _code(Opcode::invalid)
+    , _packet_id(0)
+    , _payload()
+    , _data()
+    , _encoding(PayloadEncoding::json)
+    , _is_decoded(true)
+    , _decode_error(ONE_ERROR_NONE) {}
+
+Message::Message(JsonArena *arena)
+    : _code(Opcode::invalid)
+    , _packet_id(0)
+    , _payload(arena)
+    , _data()
+    , _encoding(PayloadEncoding::json)
+    , _is_decoded(true)
+    , _decode_error(ONE_ERROR_NONE) {}
+
+Message::Message(const Message &other)
+    : _code(other._code)
+    , _packet_id(other._packet_id)
+    , _payload(other._payload)
+    , _data(other._data)
+    , _encoding(other._encoding)
+    , _is_decoded(other._is_decoded)
+    , _decode_error(other._decode_error) {}
 
-Message::Message(const Message &other) {
-    _code = other.code();
-    _payload = other.payload();
+Message &Message::operator=(const Message &other) {
+    _code = other._code;
+    _packet_id = other._packet_id;
+    _payload = other._payload;
+    _data = other._data;
+    _encoding = other._encoding;
+    _is_decoded = other._is_decoded;
+    _decode_error = other._decode_error;
+    return *this;
 }
 
-Message &Message::operator=(const Message &other) {
-    _code = other.code();
-    _payload = other.payload();
+Message::Message(Message &&other)
+    : _code(Opcode::invalid)
+    , _packet_id(0)
+    , _payload()
+    , _data()
+    , _encoding(PayloadEncoding::json)
+    , _is_decoded(true)
+    , _decode_error(ONE_ERROR_NONE) {
+    *this = std::move(other);
+}
+
+Message &Message::operator=(Message &&other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    _code = other._code;
+    _packet_id = other._packet_id;
+    if (other._is_decoded && other._encoding == PayloadEncoding::json &&
+        !other._data.empty()) {
+        // The payload strings refer to the data of the other message, which
+        // does not survive it.
+        _payload = other._payload;
+        _data.clear();
+    } else {
+        _payload = std::move(other._payload);
+        _data = std::move(other._data);
+    }
+    _encoding = other._encoding;
+    _is_decoded = other._is_decoded;
+    _decode_error = other._decode_error;
+    other.reset();
     return *this;
 }
 
-OneError Message::init(Opcode code, std::pair<const char *, size_t> data) {
+OneError Message::init(Opcode code, std::pair<const char *, size_t> data,
+                       PayloadEncoding encoding) {
     _code = code;
-    auto err = _payload.from_json(data);
-    if (is_error(err)) {
-        _code = Opcode::invalid;
-        return err;
+    _payload.clear();
+    _encoding = encoding;
+    _decode_error = ONE_ERROR_NONE;
+
+    // No data means an empty payload, there is nothing to parse.
+    if (data.first == nullptr || data.second == 0) {
+        _data.clear();
+        _is_decoded = true;
+        return ONE_ERROR_NONE;
     }
 
+    // Assigning reuses the string capacity of previous messages.
+    _data.assign(data.first, data.second);
+    _is_decoded = false;
+    return ONE_ERROR_NONE;
+}
+
+OneError Message::init(Opcode code, size_t length, PayloadEncoding encoding,
+                       char *&data) {
+    assert(length > 0);
+    _code = code;
+    _payload.clear();
+    _encoding = encoding;
+    _decode_error = ONE_ERROR_NONE;
+
+    // Resizing reuses the string capacity of previous messages.
+    _data.resize(length);
+    _is_decoded = false;
+    data = &_data[0];
     return ONE_ERROR_NONE;
 }
 
 OneError Message::init(Opcode code, const Payload &payload) {
     _code = code;
     _payload = payload;
+    _data.clear();
+    _encoding = PayloadEncoding::json;
+    _is_decoded = true;
+    _decode_error = ONE_ERROR_NONE;
+    return ONE_ERROR_NONE;
+}
+
+OneError Message::init(Opcode code, Payload &&payload) {
+    _code = code;
+    _payload = std::move(payload);
+    _data.clear();
+    _encoding = PayloadEncoding::json;
+    _is_decoded = true;
+    _decode_error = ONE_ERROR_NONE;
     return ONE_ERROR_NONE;
 }
 
 void Message::reset() {
     _code = Opcode::invalid;
+    _packet_id = 0;
     _payload.clear();
+    _data.clear();
+    _encoding = PayloadEncoding::json;
+    _is_decoded = true;
+    _decode_error = ONE_ERROR_NONE;
+}
+
+size_t Message::release_data(size_t max_capacity) {
+    // The payload of a message that is not reset may refer to the data.
+    assert(_code == Opcode::invalid);
+    const size_t capacity = _data.capacity();
+    if (capacity <= max_capacity) {
+        return 0;
+    }
+
+    // Clearing keeps the capacity, only swapping with an empty string frees it.
+    String().swap(_data);
+    return capacity;
+}
+
+OneError Message::decode() const {
+    if (_is_decoded) {
+        return _decode_error;
+    }
+
+    // JSON data is parsed in place. The string is null terminated and is not
+    // modified until the next init or reset, which clear the payload first.
+    _is_decoded = true;
+    if (_encoding == PayloadEncoding::msgpack) {
+        _decode_error = _payload.from_msgpack({_data.data(), _data.size()});
+    } else {
+        _decode_error = _payload.from_json_insitu(&_data[0]);
+    }
+    if (is_error(_decode_error)) {
+        _payload.clear();
+    }
+    return _decode_error;
+}
+
+String Message::payload_json() const {
+    if (!_is_decoded && _encoding == PayloadEncoding::json) {
+        return _data;
+    }
+    decode();
+    return _payload.to_json();
 }
 
 Opcode Message::code() const {
@@ -375,15 +594,34 @@ Opcode Message::code() const {
 }
 
 Payload &Message::payload() {
+    decode();
     return _payload;
 }
 
 const Payload &Message::payload() const {
+    decode();
     return _payload;
 }
 
+uint32_t Message::packet_id() const {
+    return _packet_id;
+}
+
+void Message::set_packet_id(uint32_t packet_id) {
+    _packet_id = packet_id;
+}
+
 namespace messages {
 
+void set_retained_data_capacity(size_t capacity) {
+    _retained_data_capacity =
+        (capacity != 0) ? capacity : retained_data_capacity_default;
+}
+
+size_t retained_data_capacity() {
+    return _retained_data_capacity;
+}
+
 OneError prepare_soft_stop(int timeout, Message &message) {
     Payload payload;
     auto err = payload.set_val_int("timeout", timeout);
@@ -392,7 +630,7 @@ OneError prepare_soft_stop(int timeout, Message &message) {
     }
 
     message.reset();
-    err = message.init(Opcode::soft_stop, payload);
+    err = message.init(Opcode::soft_stop, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -408,7 +646,7 @@ OneError prepare_allocated(const Array &array, Message &message) {
     }
 
     message.reset();
-    err = message.init(Opcode::allocated, payload);
+    err = message.init(Opcode::allocated, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -424,7 +662,7 @@ OneError prepare_metadata(const Array &array, Message &message) {
     }
 
     message.reset();
-    err = message.init(Opcode::metadata, payload);
+    err = message.init(Opcode::metadata, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -440,7 +678,7 @@ OneError prepare_reverse_metadata(const Array &array, Message &message) {
     }
 
     message.reset();
-    err = message.init(Opcode::reverse_metadata, payload);
+    err = message.init(Opcode::reverse_metadata, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -495,7 +733,7 @@ prepare_live_state(int players, int max_players, const char *name, const char *m
     }
 
     message.reset();
-    err = message.init(Opcode::live_state, payload);
+    err = message.init(Opcode::live_state, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -510,7 +748,7 @@ OneError prepare_host_information(const Object &information, Message &message) {
         return err;
     }
 
-    err = message.init(Opcode::host_information, payload);
+    err = message.init(Opcode::host_information, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -526,7 +764,7 @@ OneError prepare_application_instance_information(const Object &information,
         return err;
     }
 
-    err = message.init(Opcode::application_instance_information, payload);
+    err = message.init(Opcode::application_instance_information, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -541,7 +779,7 @@ OneError prepare_application_instance_status(int status, Message &message) {
         return err;
     }
 
-    err = message.init(Opcode::application_instance_status, payload);
+    err = message.init(Opcode::application_instance_status, std::move(payload));
     if (is_error(err)) {
         return err;
     }
@@ -557,7 +795,7 @@ OneError prepare_custom_command(const Array &array, Message &message) {
     }
 
     message.reset();
-    err = message.init(Opcode::custom_command, payload);
+    err = message.init(Opcode::custom_command, std::move(payload));
     if (is_error(err)) {
         return err;
     }
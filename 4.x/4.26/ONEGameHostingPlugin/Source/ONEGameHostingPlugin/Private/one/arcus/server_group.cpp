@@ -0,0 +1,285 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include <one/arcus/server_group.h>
+
+#include <one/arcus/internal/codec.h>
+#include <one/arcus/internal/poller.h>
+#include <one/arcus/server.h>
+
+#include <algorithm>
+
+namespace i3d {
+namespace one {
+
+namespace {
+// Interval of the updates of all servers, for the listen retries and the
+// handshake and health check timers of the connections, the shortest being one
+// second.
+constexpr int timers_update_interval_ms = 250;
+}  // namespace
+
+// See: https://en.cppreference.com/w/cpp/language/value_initialization
+// C++11 Value initialization
+ServerGroup::ServerGroup()
+    : _group()
+    , _update()
+    , _poller(nullptr)
+    , _compression_buffer(nullptr)
+    , _servers()
+    , _schedule()
+    , _scheduled()
+    , _updating()
+    , _updating_server(nullptr)
+    , _updated()
+    , _update_count(0)
+    , _last_timers_update() {}
+
+ServerGroup::~ServerGroup() {
+    shutdown();
+}
+
+OneError ServerGroup::init() {
+    const std::lock_guard<std::mutex> lock(_group);
+
+    if (_poller != nullptr) {
+        return ONE_ERROR_SERVER_ALREADY_INITIALIZED;
+    }
+
+    _poller = allocator::create<Poller>();
+    if (_poller == nullptr) {
+        return ONE_ERROR_SERVER_ALLOCATION_FAILED;
+    }
+
+    auto err = _poller->init();
+    if (is_error(err)) {
+        allocator::destroy<Poller>(_poller);
+        _poller = nullptr;
+        return err;
+    }
+
+    _compression_buffer = static_cast<char *>(
+        allocator::alloc(codec::payload_max_size(), allocator::Tag::connection));
+    if (_compression_buffer == nullptr) {
+        allocator::destroy<Poller>(_poller);
+        _poller = nullptr;
+        return ONE_ERROR_SERVER_ALLOCATION_FAILED;
+    }
+
+    _last_timers_update = std::chrono::steady_clock::now();
+    return ONE_ERROR_NONE;
+}
+
+OneError ServerGroup::shutdown() {
+    const std::lock_guard<std::mutex> lock(_group);
+
+    for (auto server : _servers) {
+        const std::lock_guard<std::mutex> server_lock(server->_server);
+        server->shutdown_server();
+    }
+    _servers.clear();
+    // A concurrent update skips the remaining servers.
+    _updating.clear();
+
+    if (_compression_buffer != nullptr) {
+        allocator::free(_compression_buffer);
+        _compression_buffer = nullptr;
+    }
+
+    // Servers scheduled concurrently wake the poller with the schedule lock
+    // held.
+    const std::lock_guard<std::mutex> schedule_lock(_schedule);
+    _scheduled.clear();
+    if (_poller != nullptr) {
+        allocator::destroy<Poller>(_poller);
+        _poller = nullptr;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+OneError ServerGroup::add(Server &server, unsigned int listen_port) {
+    const std::lock_guard<std::mutex> lock(_group);
+
+    if (_poller == nullptr) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    auto err = server.init_in_group(listen_port, *this, *_poller, _compression_buffer);
+    if (is_error(err) && err != ONE_ERROR_SOCKET_BIND_FAILED) {
+        return err;
+    }
+
+    _servers.push_back(&server);
+    return ONE_ERROR_NONE;
+}
+
+OneError ServerGroup::remove(Server &server) {
+    std::unique_lock<std::mutex> lock(_group);
+
+    auto it = std::find(_servers.begin(), _servers.end(), &server);
+    if (it == _servers.end()) {
+        return ONE_ERROR_SERVER_NOT_IN_GROUP;
+    }
+    _servers.erase(it);
+
+    // Not updated by the ongoing update, if any, once its current update
+    // returns.
+    std::replace(_updating.begin(), _updating.end(), &server,
+                 static_cast<Server *>(nullptr));
+    _updated.wait(lock, [this, &server]() { return _updating_server != &server; });
+
+    {
+        const std::lock_guard<std::mutex> server_lock(server._server);
+        server.shutdown_server();
+    }
+
+    const std::lock_guard<std::mutex> schedule_lock(_schedule);
+    _scheduled.erase(std::remove(_scheduled.begin(), _scheduled.end(), &server),
+                     _scheduled.end());
+    return ONE_ERROR_NONE;
+}
+
+size_t ServerGroup::size() const {
+    const std::lock_guard<std::mutex> lock(_group);
+    return _servers.size();
+}
+
+OneError ServerGroup::update() {
+    const std::lock_guard<std::mutex> update_lock(_update);
+    std::unique_lock<std::mutex> lock(_group);
+
+    if (_poller == nullptr) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    // Gather the readiness of the sockets of all servers with a single system
+    // call.
+    auto err = _poller->poll(0);
+    if (is_error(err)) {
+        return err;
+    }
+
+    ++_update_count;
+    _updating.clear();
+    auto collect = [this](Server *server) {
+        // Removed since the poll, or already collected.
+        if (server == nullptr || server->_group_update_count == _update_count) {
+            return;
+        }
+        server->_group_update_count = _update_count;
+        _updating.push_back(server);
+    };
+
+    for (size_t i = 0; i < _poller->ready_count(); ++i) {
+        collect(static_cast<Server *>(_poller->ready_context(i)));
+    }
+
+    {
+        // Servers scheduled from here on are updated by the next update.
+        const std::lock_guard<std::mutex> schedule_lock(_schedule);
+        for (auto server : _scheduled) {
+            collect(server);
+        }
+        _scheduled.clear();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _last_timers_update >= std::chrono::milliseconds(timers_update_interval_ms)) {
+        _last_timers_update = now;
+        for (auto server : _servers) {
+            collect(server);
+        }
+    }
+
+    // The servers are updated without the group lock, which their callbacks
+    // take to remove servers.
+    OneError result = ONE_ERROR_NONE;
+    for (size_t i = 0; i < _updating.size(); ++i) {
+        Server *server = _updating[i];
+        if (server == nullptr) {
+            continue;
+        }
+        _updating_server = server;
+        lock.unlock();
+
+        err = server->update_in_group();
+
+        lock.lock();
+        _updating_server = nullptr;
+        _updated.notify_all();
+        if (is_error(err) && !is_error(result)) {
+            result = err;
+        }
+    }
+    _updating.clear();
+
+    return result;
+}
+
+OneError ServerGroup::wait(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(_group);
+
+    if (_poller == nullptr) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - _last_timers_update)
+                             .count();
+    const int until_timers =
+        std::max(0, timers_update_interval_ms - static_cast<int>(elapsed));
+    if (timeout_ms < 0 || timeout_ms > until_timers) {
+        timeout_ms = until_timers;
+    }
+
+    {
+        // A server scheduled after this also wakes the poller.
+        const std::lock_guard<std::mutex> schedule_lock(_schedule);
+        if (!_scheduled.empty()) {
+            return ONE_ERROR_NONE;
+        }
+    }
+
+    // The poller is only destroyed by shutdown.
+    Poller *poller = _poller;
+    lock.unlock();
+    return poller->wait(timeout_ms);
+}
+
+void ServerGroup::wake() {
+    const std::lock_guard<std::mutex> lock(_group);
+    if (_poller != nullptr) {
+        _poller->wake();
+    }
+}
+
+OneError ServerGroup::descriptor(int &descriptor) const {
+    const std::lock_guard<std::mutex> lock(_group);
+
+    if (_poller == nullptr) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    descriptor = _poller->descriptor();
+    if (descriptor < 0) {
+        return ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+void ServerGroup::schedule(Server &server) {
+    if (server._is_scheduled.exchange(true)) {
+        return;
+    }
+
+    // The group lock is not taken, since the server may be scheduled while its
+    // lock is held, which remove takes after the group lock.
+    const std::lock_guard<std::mutex> lock(_schedule);
+    _scheduled.push_back(&server);
+    if (_poller != nullptr) {
+        _poller->wake();
+    }
+}
+
+}  // namespace one
+}  // namespace i3d
@@ -66,15 +66,168 @@ typedef enum OneApplicationInstanceStatus {
     ONE_SERVER_ALLOCATED = 5
 } OneeApplicationInstanceStatus;
 
+/// Message types counted separately by OneServerStats.
+typedef enum OneMessageType {
+    ONE_MESSAGE_TYPE_HEALTH = 0,
+    ONE_MESSAGE_TYPE_HELLO,
+    ONE_MESSAGE_TYPE_SOFT_STOP,
+    ONE_MESSAGE_TYPE_ALLOCATED,
+    ONE_MESSAGE_TYPE_METADATA,
+    ONE_MESSAGE_TYPE_REVERSE_METADATA,
+    ONE_MESSAGE_TYPE_LIVE_STATE,
+    ONE_MESSAGE_TYPE_HOST_INFORMATION,
+    ONE_MESSAGE_TYPE_APPLICATION_INSTANCE_INFORMATION,
+    ONE_MESSAGE_TYPE_APPLICATION_INSTANCE_STATUS,
+    ONE_MESSAGE_TYPE_CUSTOM_COMMAND,
+    ONE_MESSAGE_TYPE_OTHER,
+    ONE_MESSAGE_TYPE_COUNT
+} OneMessageType;
+
+/// Priority lanes of the outgoing messages, sent in this order: health checks,
+/// soft stops and status changes, then live state, allocation and information
+/// messages, then metadata and custom commands.
+typedef enum OneLane {
+    ONE_LANE_CONTROL = 0,
+    ONE_LANE_STATE,
+    ONE_LANE_BULK,
+    ONE_LANE_COUNT
+} OneLane;
+
+/// What a server does with a message received from the agent while its
+/// incoming queue is full, see one_server_set_incoming_overflow.
+typedef enum OneIncomingOverflow {
+    /// Closes the agent connection, the agent then reconnects.
+    ONE_INCOMING_OVERFLOW_ERROR = 0,
+    /// Grows the queue up to a maximum, then pauses.
+    ONE_INCOMING_OVERFLOW_GROW,
+    /// Stops reading from the agent until the queue has room, holding the
+    /// agent back through TCP flow control.
+    ONE_INCOMING_OVERFLOW_PAUSE,
+    /// Calls the callback of the oldest queued message from within the
+    /// reading, to make room. Pauses when the I/O thread is enabled.
+    ONE_INCOMING_OVERFLOW_DISPATCH,
+    ONE_INCOMING_OVERFLOW_COUNT
+} OneIncomingOverflow;
+
+/// Memory footprints of a server's agent connection, see
+/// one_server_set_memory_profile.
+typedef enum OneMemoryProfile {
+    /// Send and receive buffers of 128 KB each, so that bursts of large
+    /// messages take the fewest socket calls. The default.
+    ONE_MEMORY_PROFILE_THROUGHPUT = 0,
+    /// Send and receive buffers of 4 KB each, growing on demand up to 128 KB,
+    /// for hosts running many servers.
+    ONE_MEMORY_PROFILE_SMALL,
+    ONE_MEMORY_PROFILE_COUNT
+} OneMemoryProfile;
+
+/// Sizes of the buffers and queues of a server's agent connection, see
+/// one_server_set_memory_sizes.
+typedef struct OneMemorySizes {
+    /// Initial size in bytes of each of the send and receive buffers, from 1 KB
+    /// to 128 KB. Each grows on demand up to 128 KB, until the agent
+    /// disconnects.
+    unsigned int stream_size;
+    /// Size in bytes, of at least 1 KB, of the buffer that the payloads of the
+    /// received messages are parsed into. Payloads needing more allocate
+    /// additional chunks until the messages are processed.
+    unsigned int incoming_arena_size;
+    /// Capacity in messages of the incoming queue, and of each lane of the
+    /// outgoing queue but the control lane. The messages are only constructed
+    /// once the queues first hold them.
+    unsigned int incoming_queue_size;
+    unsigned int outgoing_queue_size;
+} OneMemorySizes;
+
+/// Runtime counters of a server's Arcus link, cumulative since init except
+/// the high-water marks. See one_server_stats.
+typedef struct OneServerStats {
+    unsigned long long bytes_received;
+    unsigned long long bytes_sent;
+    /// Socket system calls.
+    unsigned long long receive_calls;
+    unsigned long long send_calls;
+    unsigned long long poll_calls;
+    /// Message frames by OneMessageType, including the health and hello
+    /// messages.
+    unsigned long long messages_received[ONE_MESSAGE_TYPE_COUNT];
+    unsigned long long messages_sent[ONE_MESSAGE_TYPE_COUNT];
+    /// Highest count of messages waiting in the connection's queues, the
+    /// outgoing one being the total of its lanes.
+    unsigned long long incoming_queue_high_water;
+    unsigned long long outgoing_queue_high_water;
+    /// Outgoing message frames, their bytes, and the highest count of messages
+    /// waiting, by OneLane.
+    unsigned long long lane_messages_sent[ONE_LANE_COUNT];
+    unsigned long long lane_bytes_sent[ONE_LANE_COUNT];
+    unsigned long long lane_queue_high_water[ONE_LANE_COUNT];
+    /// Outgoing messages replaced by a newer one before being sent, see
+    /// one_server_set_coalescing.
+    unsigned long long messages_coalesced;
+    /// Received messages that found the incoming queue full, by the action
+    /// taken: growths of the queue, pauses of the reading, and queued messages
+    /// dispatched to make room. See one_server_set_incoming_overflow.
+    unsigned long long incoming_queue_grows;
+    unsigned long long incoming_read_pauses;
+    unsigned long long incoming_inline_dispatches;
+    /// Time spent encoding and decoding messages.
+    unsigned long long encode_nanoseconds;
+    unsigned long long decode_nanoseconds;
+    /// Completed handshakes and their total duration.
+    unsigned long long handshakes;
+    unsigned long long handshake_nanoseconds;
+    /// Accepted client connections, each after the first being a reconnect.
+    unsigned long long connections;
+    /// Incoming messages dispatched to the callbacks, and the total time spent
+    /// dispatching them, including the callbacks.
+    unsigned long long callbacks;
+    unsigned long long callback_nanoseconds;
+    /// Received data buffers freed once their message was consumed, for
+    /// exceeding the retained capacity, and their total size. See
+    /// one_allocator_set_message_retained_capacity.
+    unsigned long long data_releases;
+    unsigned long long data_released_bytes;
+} OneServerStats;
+
 //------------------------------------------------------------------------------
 ///@name Opaque types.
 /// The API uses the pointer handles to represent internal objects.
 ///@{
 
+/// Subsystems whose allocations are tracked separately.
+/// \sa one_allocator_set_tracking
+typedef enum OneAllocationTag {
+    ONE_ALLOCATION_TAG_OTHER = 0,
+    /// Connection stream, arena and compression buffers.
+    ONE_ALLOCATION_TAG_CONNECTION,
+    /// Message queue slots.
+    ONE_ALLOCATION_TAG_RING,
+    /// Message payload documents.
+    ONE_ALLOCATION_TAG_PAYLOAD,
+    /// Array and Object handles.
+    ONE_ALLOCATION_TAG_HANDLE,
+    ONE_ALLOCATION_TAG_STRING,
+    ONE_ALLOCATION_TAG_COUNT
+} OneAllocationTag;
+
+/// Allocation counters of a tag. The allocations and frees are cumulative,
+/// their difference between two frames shows the allocation churn.
+/// \sa one_allocator_stats
+typedef struct OneAllocationStats {
+    unsigned long long live_bytes;
+    unsigned long long peak_bytes;
+    unsigned long long allocations;
+    unsigned long long frees;
+} OneAllocationStats;
+
 /// Opaque type and handle to a One Arcus Server.
 struct OneServer;
 typedef OneServer *OneServerPtr;
 
+/// Opaque type and handle to a group of One Arcus Servers updated together.
+struct OneServerGroup;
+typedef OneServerGroup *OneServerGroupPtr;
+
 /// Opaque type and handle to a One Array value used in messages.
 struct OneArray;
 typedef OneArray *OneArrayPtr;
@@ -108,6 +261,34 @@ ONE_EXPORT void one_allocator_set_free(void (*callback)(void *));
 /// the standard c realloc requirements for behavior.
 ONE_EXPORT void one_allocator_set_realloc(void *(*callback)(void *, unsigned int size));
 
+/// Optional size of the chunks allocated by the payload arenas once their
+/// initial buffer is used up. Defaults to 4 KB. A larger payload gets a chunk
+/// of its own. If set, must be set at init time, before using any other APIs.
+/// @param size The chunk size in bytes. Zero restores the default.
+ONE_EXPORT void one_allocator_set_json_chunk_size(unsigned int size);
+
+/// Optional capacity of the received data buffer kept by each message slot of
+/// the queues for reuse. Defaults to 4 KB. The buffer of a larger message is
+/// freed once the message is consumed, so that the slots do not keep the size
+/// of the largest message they held. If set, must be set at init time, before
+/// using any other APIs.
+/// @param size The capacity in bytes. Zero restores the default.
+ONE_EXPORT void one_allocator_set_message_retained_capacity(unsigned int size);
+
+/// Optional tracking of the allocations, counting the live and peak bytes and
+/// the allocations of each OneAllocationTag. Each allocation is prefixed with
+/// its size and tag. Disabled by default. If set, must be set at init time,
+/// before using any other APIs, and after the allocator overrides.
+/// @param enabled Whether to track the allocations.
+/// @sa one_allocator_stats
+ONE_EXPORT void one_allocator_set_tracking(bool enabled);
+
+/// Obtains the allocation counters of a tag, all zero unless tracking is
+/// enabled. Thread-safe.
+/// @param tag The tag, less than ONE_ALLOCATION_TAG_COUNT.
+/// @param stats A pointer to the stats to be set.
+ONE_EXPORT OneError one_allocator_stats(OneAllocationTag tag, OneAllocationStats *stats);
+
 //------------------------------------------------------------------------------
 ///@}
 ///@name Server interface.
@@ -155,6 +336,114 @@ typedef void (*OneLogFn)(void *userdata, OneLogLevel level, const char *message)
 ONE_EXPORT OneError one_server_set_logger(OneServerPtr server, OneLogFn log_cb,
                                           void *userdata);
 
+/// Stages of the lifecycle of a message frame, reported to the trace callback.
+/// \sa one_server_set_tracer
+typedef enum OneTraceStage {
+    ONE_TRACE_STAGE_RECEIVE = 0,
+    ONE_TRACE_STAGE_HEADER_DECODE,
+    ONE_TRACE_STAGE_PAYLOAD_PARSE,
+    ONE_TRACE_STAGE_ENQUEUE,
+    ONE_TRACE_STAGE_DISPATCH_START,
+    ONE_TRACE_STAGE_DISPATCH_END,
+    ONE_TRACE_STAGE_ENCODE,
+    ONE_TRACE_STAGE_SEND_COMPLETE
+} OneTraceStage;
+
+/// Trace callback, receiving the lifecycle events of the messages.
+/// @param userdata The userdata passed to one_server_set_tracer.
+/// @param stage The stage the message reached.
+/// @param packet_id The packet id of the message's frame, which pairs the
+/// events of a message in each direction.
+/// @param opcode The Arcus opcode of the message.
+/// @param nanoseconds A monotonic timestamp of the event.
+/// \sa one_server_set_tracer
+typedef void (*OneTraceFn)(void *userdata, OneTraceStage stage, unsigned int packet_id,
+                           int opcode, unsigned long long nanoseconds);
+
+/// Sets a callback receiving timestamped events for each stage of each message
+/// received or sent, to attribute latency between the agent and the game's
+/// callbacks. Only available when the plugin is built with ONE_ARCUS_TRACING,
+/// returns ONE_ERROR_SERVER_TRACING_DISABLED otherwise; the trace points
+/// compile to nothing without it. The callback is called from the I/O thread
+/// while it is enabled, and must not be changed meanwhile.
+/// @param server A non-null server pointer.
+/// @param trace_cb Optional trace callback function. Null stops the tracing.
+/// @param userdata Optional user data that will be passed back to the callback.
+ONE_EXPORT OneError one_server_set_tracer(OneServerPtr server, OneTraceFn trace_cb,
+                                          void *userdata);
+
+/// Offers the MessagePack payload encoding to connecting agents, which is
+/// cheaper to encode and decode than JSON. It is only used with agents that
+/// accept it during the handshake, and JSON remains in use otherwise. Disabled
+/// by default. Takes effect on the next agent connection.
+/// @param server A non-null server pointer.
+/// @param enabled Whether to offer the MessagePack payload encoding.
+ONE_EXPORT OneError one_server_set_msgpack_payloads(OneServerPtr server, bool enabled);
+
+/// Offers payload compression to connecting agents, for large payloads such
+/// as metadata and custom commands. Payloads of at least the threshold length
+/// are compressed in both directions, when the agent accepts it and
+/// compression makes them smaller. Disabled by default. Takes effect on the
+/// next agent connection.
+/// @param server A non-null server pointer.
+/// @param threshold Minimum payload length in bytes to compress, or 0 to
+/// disable compression.
+ONE_EXPORT OneError one_server_set_compression_threshold(OneServerPtr server,
+                                                         unsigned int threshold);
+
+/// Sets whether the outgoing messages of a type only matter by their latest
+/// value. A coalesced message does not take room in the outgoing queue: it
+/// replaces the previous message of its type that is not yet sent, and is
+/// sent at most once per minimum interval. Application instance status, live
+/// state and reverse metadata messages can be coalesced. The first two are by
+/// default, without interval. Reverse metadata are not, so that each is
+/// delivered. Takes effect on the next agent connection.
+/// @param server A non-null server pointer.
+/// @param type ONE_MESSAGE_TYPE_APPLICATION_INSTANCE_STATUS,
+/// ONE_MESSAGE_TYPE_LIVE_STATE or ONE_MESSAGE_TYPE_REVERSE_METADATA.
+/// @param enabled Whether to coalesce the messages of the type.
+/// @param min_interval_ms Minimum interval between two sent messages of the
+/// type, in milliseconds, or 0 for none.
+ONE_EXPORT OneError one_server_set_coalescing(OneServerPtr server, OneMessageType type,
+                                              bool enabled, unsigned int min_interval_ms);
+
+/// Sets what is done with a message received from the agent while the
+/// incoming queue, of 48 messages by default, is full: a burst of more
+/// messages between two one_server_update calls. Pausing by default, so that a
+/// burst delays the messages rather than causing a reconnect. Takes effect on
+/// the next agent connection.
+/// @param server A non-null server pointer.
+/// @param policy The action taken, see OneIncomingOverflow.
+/// @param max_messages The capacity up to which ONE_INCOMING_OVERFLOW_GROW
+/// grows the queue. Ignored by the other policies.
+ONE_EXPORT OneError one_server_set_incoming_overflow(OneServerPtr server,
+                                                     OneIncomingOverflow policy,
+                                                     unsigned int max_messages);
+
+/// Sets the memory footprint of the agent connection to that of a profile.
+/// Takes effect on the next agent connection.
+/// @param server A non-null server pointer.
+/// @param profile The profile, see OneMemoryProfile.
+ONE_EXPORT OneError one_server_set_memory_profile(OneServerPtr server,
+                                                  OneMemoryProfile profile);
+
+/// Sets the sizes of the buffers and queues of the agent connection. Takes
+/// effect on the next agent connection.
+/// @param server A non-null server pointer.
+/// @param sizes The sizes, see OneMemorySizes.
+ONE_EXPORT OneError one_server_set_memory_sizes(OneServerPtr server,
+                                                const OneMemorySizes *sizes);
+
+/// Moves the socket I/O, message encoding and decoding, and payload parsing of
+/// the server to a dedicated thread. one_server_update then only calls the
+/// callbacks of received messages and queues outgoing messages, without any
+/// system call, keeping the server's work off the game thread. Disabled by
+/// default. While enabled, the logger set with one_server_set_logger is called
+/// from the I/O thread and must not be changed.
+/// @param server A non-null server pointer.
+/// @param enabled Whether to run the server I/O on a dedicated thread.
+ONE_EXPORT OneError one_server_set_io_thread(OneServerPtr server, bool enabled);
+
 /// Destroys a server instance created via one_server_create. Destroy will
 /// shutdown the server first, if it is active. Note although other server functions
 /// are thread safe, this one is not. A server must not be destroyed or interacted
@@ -172,12 +461,98 @@ ONE_EXPORT void one_server_destroy(OneServerPtr server);
 /// @param server A non-null server pointer. Thread-safe.
 ONE_EXPORT OneError one_server_update(OneServerPtr server);
 
+/// Blocks until one_server_update has work to do, or for at most the given
+/// timeout, to be called between updates instead of sleeping. The work is a
+/// received message, a connecting agent, a socket ready to send, a changed
+/// property to send, or a call to one_server_wake. Returns immediately if some
+/// is already pending. The timeout is capped to one second, which a negative
+/// timeout also waits, so that the connection's timers keep running. Must be
+/// called on the thread calling one_server_update, and not concurrently with
+/// one_server_init, one_server_shutdown or one_server_set_io_thread.
+/// @param server A non-null server pointer.
+/// @param timeout_ms The longest wait, in milliseconds.
+ONE_EXPORT OneError one_server_wait(OneServerPtr server, int timeout_ms);
+
+/// Ends a concurrent or the next one_server_wait. Thread-safe.
+/// @param server A non-null server pointer.
+ONE_EXPORT OneError one_server_wake(OneServerPtr server);
+
+/// Obtains a file descriptor that is readable whenever one_server_wait would
+/// return, to nest the server in another event loop, calling
+/// one_server_update when it is readable. It is valid until shutdown.
+/// Returns ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE on Windows and while the I/O
+/// thread is enabled. Thread-safe.
+/// @param server A non-null server pointer.
+/// @param descriptor A pointer to the descriptor to be set.
+ONE_EXPORT OneError one_server_descriptor(OneServerPtr const server, int *descriptor);
+
 /// Obtains the status of the server. Thread-safe. The passed in pointer is set
 /// to the status value.
 /// @param server A non-null server pointer.
 /// @param status A pointer to a status enum value to be set.
 ONE_EXPORT OneError one_server_status(OneServerPtr const server, OneServerStatus *status);
 
+/// Obtains the runtime counters of the server. Cheap enough to be called every
+/// frame. While the I/O thread is enabled, the link counters are as of its
+/// last update. Thread-safe.
+/// @param server A non-null, initialized server pointer.
+/// @param stats A pointer to the stats to be set.
+ONE_EXPORT OneError one_server_stats(OneServerPtr const server, OneServerStats *stats);
+
+//------------------------------------------------------------------------------
+///@}
+///@name Server group interface.
+/// A server group hosts many servers in one process, one per game session,
+/// and updates them all from a single readiness loop. An update only costs the
+/// servers with activity, rather than all servers. The servers of a group are
+/// updated, waited for and polled through the group only.
+///@{
+
+/// Creates a new, empty server group. Must be destroyed with
+/// one_server_group_destroy. Thread-safe.
+/// @param group A null group pointer, which will be set to a new group.
+ONE_EXPORT OneError one_server_group_create(OneServerGroupPtr *group);
+
+/// Shuts down the servers remaining in the group, and destroys it. The servers
+/// must still be destroyed with one_server_destroy.
+/// @param group A non-null group pointer.
+ONE_EXPORT void one_server_group_destroy(OneServerGroupPtr group);
+
+/// Creates a new Arcus Server in the group, as one_server_create does. Its
+/// callbacks and properties are set as for any other server. Destroying it
+/// with one_server_destroy removes it from the group. Thread-safe.
+/// @param group A non-null group pointer.
+/// @param port The port to bind to and listen on for incoming Client connections.
+/// @param server A null server pointer, which will be set to a new server.
+ONE_EXPORT OneError one_server_group_create_server(OneServerGroupPtr group,
+                                                   unsigned int port,
+                                                   OneServerPtr *server);
+
+/// Updates the servers of the group that have received data, a connecting
+/// agent, or properties to send, as one_server_update does. Every server is
+/// updated and the first error of a server is returned. Thread-safe.
+/// @param group A non-null group pointer.
+ONE_EXPORT OneError one_server_group_update(OneServerGroupPtr group);
+
+/// Blocks until one_server_group_update has work to do, or for at most the
+/// given timeout, as one_server_wait does for a single server. Must be called
+/// on the thread calling one_server_group_update.
+/// @param group A non-null group pointer.
+/// @param timeout_ms The longest wait, in milliseconds.
+ONE_EXPORT OneError one_server_group_wait(OneServerGroupPtr group, int timeout_ms);
+
+/// Ends a concurrent or the next one_server_group_wait. Thread-safe.
+/// @param group A non-null group pointer.
+ONE_EXPORT OneError one_server_group_wake(OneServerGroupPtr group);
+
+/// Obtains a file descriptor that is readable whenever one_server_group_wait
+/// would return, as one_server_descriptor does for a single server.
+/// Thread-safe.
+/// @param group A non-null group pointer.
+/// @param descriptor A pointer to the descriptor to be set.
+ONE_EXPORT OneError one_server_group_descriptor(OneServerGroupPtr const group,
+                                                int *descriptor);
+
 //------------------------------------------------------------------------------
 ///@}
 ///@name Array main interface
@@ -15,6 +15,7 @@ class Array;
 class Connection;
 class Message;
 class Object;
+class Poller;
 class Socket;
 
 struct ClientCallbacks {
@@ -87,8 +88,8 @@ private:
     // The server must have an active and ready listen connection in order to
     // send outgoing messages. If not, either ONE_ERROR_SERVER_CONNECTION_IS_NULLPTR or
     // ONE_ERROR_SERVER_CONNECTION_NOT_READY is returned and the message is
-    // not sent.
-    OneError process_outgoing_message(const Message &message);
+    // not sent. The message is moved into the outgoing queue.
+    OneError process_outgoing_message(Message &&message);
 
     bool is_initialized() const {
         return _socket != nullptr;
@@ -101,6 +102,7 @@ private:
     String _server_address;
     unsigned int _server_port;
 
+    Poller *_poller;
     Socket *_socket;
     Connection *_connection;
     bool _is_connected;
@@ -22,6 +22,11 @@ OneError soft_stop(const Message &message, params::SoftStopRequest &params) {
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_SOFT_STOP;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     const auto err = payload.val_int("timeout", params._timeout);
     if (is_error(err)) {
@@ -41,6 +46,11 @@ OneError allocated(const Message &message, params::AllocatedRequest &params) {
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_ALLOCATED;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_array("data", params._data);
     if (is_error(err)) {
@@ -60,6 +70,11 @@ OneError metadata(const Message &message, params::MetaDataRequest &params) {
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_METADATA;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_array("data", params._data);
     if (is_error(err)) {
@@ -80,6 +95,11 @@ OneError reverse_metadata(const Message &message,
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_REVERSE_METADATA;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_array("data", params._data);
     if (is_error(err)) {
@@ -99,6 +119,11 @@ OneError live_state(const Message &message, params::LiveStateResponse &params) {
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_LIVE_STATE;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_int("players", params._players);
     if (is_error(err)) {
@@ -144,6 +169,11 @@ OneError host_information(const Message &message,
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_HOST_INFORMATION;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_root_object(params._host_information);
     if (is_error(err)) {
@@ -164,6 +194,11 @@ OneError application_instance_information(
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_APPLICATION_INSTANCE_INFORMATION;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_root_object(params._application_instance_information);
     if (is_error(err)) {
@@ -184,6 +219,11 @@ OneError application_instance_status(
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_APPLICATION_INSTANCE_STATUS;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     const auto err = payload.val_int("status", params._status);
     if (is_error(err)) {
@@ -203,6 +243,11 @@ OneError custom_command(const Message &message, params::CustomCommandRequest &pa
         return ONE_ERROR_MESSAGE_OPCODE_NOT_MATCHING_EXPECTING_CUSTOM_COMMAND;
     }
 
+    const auto decode_err = message.decode();
+    if (is_error(decode_err)) {
+        return decode_err;
+    }
+
     const auto &payload = message.payload();
     auto err = payload.val_array("data", params._data);
     if (is_error(err)) {
@@ -0,0 +1,148 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <one/arcus/allocator.h>
+#include <one/arcus/error.h>
+#include <one/arcus/internal/socket.h>
+
+#if !defined(ONE_WINDOWS)
+    #include <sys/epoll.h>
+#endif
+
+namespace i3d {
+namespace one {
+
+// Poller is a readiness notifier for a set of registered sockets. Sockets are
+// registered once, and each call to poll gathers the readiness of all of them
+// with a single system call, instead of querying each socket individually
+// before every read and send. Uses epoll on Linux and WSAPoll on Windows.
+//
+// Registrations are level-triggered: a socket stays readable until all its
+// pending data has been received. Read interest can be disabled while the
+// owner cannot take more data, so that pending data does not end every wait.
+// Write interest is opt-in per socket and should only be enabled while data is
+// pending that could not be sent, since a connected socket with space in its
+// send buffer is always writable.
+//
+// Sockets are looked up by descriptor in constant time, and a poll only costs
+// the number of ready sockets on Linux, so that a single poller can serve the
+// sockets of many servers. Each socket may carry a context, which is reported
+// for the sockets found ready by the last poll.
+//
+// On Linux, a wait can be interrupted from any thread with wake, and the
+// epoll descriptor is exposed so that the poller can be nested in another
+// event loop: it is readable whenever a registered socket is ready or a wake is
+// pending. Windows has no wake support, waits only end on socket readiness or
+// timeout.
+class Poller final {
+public:
+    Poller();
+    Poller(const Poller &) = delete;
+    Poller &operator=(const Poller &) = delete;
+    ~Poller();
+
+    // Must be called before any other function. Safe to call after shutdown.
+    OneError init();
+
+    // Unregisters all sockets and releases the system resources.
+    void shutdown();
+
+    bool is_initialized() const;
+
+    // Registers an initialized socket for read readiness notifications, with
+    // an optional context reported by ready_context.
+    OneError add(const Socket &socket, void *context = nullptr);
+
+    // Unregisters the socket. Must be called before the socket is closed.
+    OneError remove(const Socket &socket);
+
+    // Enables or disables read readiness notifications for a registered
+    // socket, enabled by add. Errors and hang-ups are reported regardless. Does
+    // nothing if the interest is unchanged.
+    OneError set_read_interest(const Socket &socket, bool enable);
+
+    // Enables or disables write readiness notifications for a registered
+    // socket. Does nothing if the interest is unchanged.
+    OneError set_write_interest(const Socket &socket, bool enable);
+
+    // Waits at most timeout_ms milliseconds for any registered socket to become
+    // ready, and records the readiness of all registered sockets. Use 0 to
+    // return immediately. Makes no system call if no sockets are registered.
+    OneError poll(int timeout_ms);
+
+    // Waits at most timeout_ms milliseconds for any registered socket to become
+    // ready or for a wake, without recording readiness. The following poll
+    // gathers it. Sleeps for the timeout if no sockets are registered.
+    OneError wait(int timeout_ms);
+
+    // Ends the current or next wait. Safe to call from any thread while the
+    // poller is initialized. Does nothing on Windows.
+    void wake();
+
+    // The descriptor that is readable while a wait would not block, or -1 if
+    // unavailable, which is always the case on Windows.
+    int descriptor() const;
+
+    // Readiness of the socket as of the last poll. The socket is considered
+    // ready if it has pending data, an error, or was closed by the remote end,
+    // so that the following receive or send reports the actual state.
+    bool is_readable(const Socket &socket) const;
+    bool is_writable(const Socket &socket) const;
+
+    // The sockets found ready by the last poll, in no particular order. The
+    // context of a socket removed since is null.
+    size_t ready_count() const {
+        return _ready.size();
+    }
+    void *ready_context(size_t index) const;
+
+private:
+    struct Entry {
+        SOCKET socket;
+        void *context;
+        bool read_interest;
+        bool write_interest;
+        bool readable;
+        bool writable;
+    };
+    using Entries = std::vector<Entry, StandardAllocator<Entry>>;
+    // Index of each registered socket in the entries.
+    using Index = std::unordered_map<SOCKET, size_t, std::hash<SOCKET>, std::equal_to<SOCKET>,
+                                     StandardAllocator<std::pair<const SOCKET, size_t>>>;
+    using Sockets = std::vector<SOCKET, StandardAllocator<SOCKET>>;
+
+    Entry *find(SOCKET socket);
+    const Entry *find(SOCKET socket) const;
+    // Applies the interests of a registered socket to the system poller.
+    OneError modify(const Entry &entry, bool read, bool write);
+
+    Entries _entries;
+    Index _index;
+    // Sockets found ready by the last poll, whose readiness is cleared by the
+    // next one.
+    Sockets _ready;
+
+#if defined(ONE_WINDOWS)
+    std::vector<WSAPOLLFD, StandardAllocator<WSAPOLLFD>> _poll_fds;
+    bool _is_initialized;
+#else
+    // Sockets ready beyond this are reported by the next poll.
+    static constexpr size_t max_events = 64;
+
+    // Clears a pending wake.
+    void drain_wake();
+
+    int _epoll;
+    // eventfd registered with the epoll to wake it.
+    int _wake;
+    std::array<epoll_event, max_events> _events;
+#endif
+};
+
+}  // namespace one
+}  // namespace i3d
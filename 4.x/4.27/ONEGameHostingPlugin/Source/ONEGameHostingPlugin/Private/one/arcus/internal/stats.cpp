@@ -0,0 +1,132 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include <one/arcus/internal/stats.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace i3d {
+namespace one {
+namespace stats {
+
+size_t message_type_index(Opcode code) {
+    MessageType type = MessageType::other;
+    switch (code) {
+        case Opcode::health:
+            type = MessageType::health;
+            break;
+        case Opcode::hello:
+            type = MessageType::hello;
+            break;
+        case Opcode::soft_stop:
+            type = MessageType::soft_stop;
+            break;
+        case Opcode::allocated:
+            type = MessageType::allocated;
+            break;
+        case Opcode::metadata:
+            type = MessageType::metadata;
+            break;
+        case Opcode::reverse_metadata:
+            type = MessageType::reverse_metadata;
+            break;
+        case Opcode::live_state:
+            type = MessageType::live_state;
+            break;
+        case Opcode::host_information:
+            type = MessageType::host_information;
+            break;
+        case Opcode::application_instance_information:
+            type = MessageType::application_instance_information;
+            break;
+        case Opcode::application_instance_status:
+            type = MessageType::application_instance_status;
+            break;
+        case Opcode::custom_command:
+            type = MessageType::custom_command;
+            break;
+        default:
+            break;
+    }
+    return static_cast<size_t>(type);
+}
+
+uint64_t now_nanoseconds() {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+}  // namespace stats
+
+// See: https://en.cppreference.com/w/cpp/language/value_initialization
+// C++11 Value initialization
+Stats::Stats()
+    : bytes_received(0)
+    , bytes_sent(0)
+    , receive_calls(0)
+    , send_calls(0)
+    , poll_calls(0)
+    , messages_received{}
+    , messages_sent{}
+    , incoming_queue_high_water(0)
+    , outgoing_queue_high_water(0)
+    , lane_messages_sent{}
+    , lane_bytes_sent{}
+    , lane_queue_high_water{}
+    , messages_coalesced(0)
+    , incoming_queue_grows(0)
+    , incoming_read_pauses(0)
+    , incoming_inline_dispatches(0)
+    , encode_nanoseconds(0)
+    , decode_nanoseconds(0)
+    , handshakes(0)
+    , handshake_nanoseconds(0)
+    , connections(0)
+    , callbacks(0)
+    , callback_nanoseconds(0)
+    , data_releases(0)
+    , data_released_bytes(0) {}
+
+void Stats::add(const Stats &other) {
+    bytes_received += other.bytes_received;
+    bytes_sent += other.bytes_sent;
+    receive_calls += other.receive_calls;
+    send_calls += other.send_calls;
+    poll_calls += other.poll_calls;
+    for (size_t i = 0; i < stats::message_type_count(); ++i) {
+        messages_received[i] += other.messages_received[i];
+        messages_sent[i] += other.messages_sent[i];
+    }
+    incoming_queue_high_water =
+        std::max(incoming_queue_high_water, other.incoming_queue_high_water);
+    outgoing_queue_high_water =
+        std::max(outgoing_queue_high_water, other.outgoing_queue_high_water);
+    for (size_t i = 0; i < lane_count(); ++i) {
+        lane_messages_sent[i] += other.lane_messages_sent[i];
+        lane_bytes_sent[i] += other.lane_bytes_sent[i];
+        lane_queue_high_water[i] =
+            std::max(lane_queue_high_water[i], other.lane_queue_high_water[i]);
+    }
+    messages_coalesced += other.messages_coalesced;
+    incoming_queue_grows += other.incoming_queue_grows;
+    incoming_read_pauses += other.incoming_read_pauses;
+    incoming_inline_dispatches += other.incoming_inline_dispatches;
+    encode_nanoseconds += other.encode_nanoseconds;
+    decode_nanoseconds += other.decode_nanoseconds;
+    handshakes += other.handshakes;
+    handshake_nanoseconds += other.handshake_nanoseconds;
+    connections += other.connections;
+    callbacks += other.callbacks;
+    callback_nanoseconds += other.callback_nanoseconds;
+    data_releases += other.data_releases;
+    data_released_bytes += other.data_released_bytes;
+}
+
+void Stats::count_release(size_t released) {
+    if (released == 0) return;
+    ++data_releases;
+    data_released_bytes += released;
+}
+
+}  // namespace one
+}  // namespace i3d
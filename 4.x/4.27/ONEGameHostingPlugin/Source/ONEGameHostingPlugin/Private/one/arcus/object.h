@@ -2,14 +2,13 @@
 #pragma once
 
 #include <functional>
+#include <stdint.h>
 #include <utility>
 
 #include <one/arcus/error.h>
-#include <one/arcus/internal/rapidjson/document.h>
+#include <one/arcus/internal/json.h>
 #include <one/arcus/types.h>
 
-namespace rapidjson = RAPIDJSON_NAMESPACE;
-
 namespace i3d {
 namespace one {
 
@@ -23,8 +22,8 @@ public:
     Object &operator=(const Object &other);
     ~Object() = default;
 
-    OneError set(const rapidjson::Value &object);
-    const rapidjson::Value &get() const {
+    OneError set(const JsonValue &object);
+    const JsonValue &get() const {
         return _doc;
     }
 
@@ -55,8 +54,16 @@ public:
     OneError set_val_array(const char *key, const Array &val);
     OneError set_val_object(const char *key, const Object &val);
 
+    // Identifies the content. It changes on each modification and is kept by
+    // copies, so that equal versions mean equal content, without reading it.
+    // Versions are unique across objects, 0 being that of new empty objects.
+    uint64_t version() const {
+        return _version;
+    }
+
 private:
-    rapidjson::Document _doc;
+    JsonDocument _doc;
+    uint64_t _version;
 };
 
 }  // namespace one
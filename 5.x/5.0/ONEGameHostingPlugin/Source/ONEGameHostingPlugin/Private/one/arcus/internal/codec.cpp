@@ -2,7 +2,9 @@
 #include <one/arcus/internal/codec.h>
 
 #include <one/arcus/internal/endian.h>
+#include <one/arcus/internal/lz4.h>
 #include <one/arcus/internal/messages.h>
+#include <one/arcus/internal/msgpack.h>
 #include <one/arcus/message.h>
 
 #include <cstring>
@@ -12,10 +14,109 @@ namespace i3d {
 namespace one {
 namespace codec {
 
+namespace {
+
+// A rapidjson output stream writing to a fixed size buffer, so that JSON can be
+// written directly to its destination without intermediate strings. Writes
+// past the end of the buffer are dropped and flag the stream as overflowed.
+class FixedBufferStream final {
+public:
+    typedef char Ch;
+
+    FixedBufferStream(char *data, size_t capacity)
+        : _data(data), _capacity(capacity), _size(0), _overflowed(false) {}
+
+    void Put(Ch c) {
+        if (_size < _capacity) {
+            _data[_size++] = c;
+            return;
+        }
+        _overflowed = true;
+    }
+
+    void Flush() {}
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool overflowed() const {
+        return _overflowed;
+    }
+
+private:
+    char *_data;
+    const size_t _capacity;
+    size_t _size;
+    bool _overflowed;
+};
+
+// Compressed payload length prefix, see compressed_payload_prefix_size. Its
+// byte order is the one of the header fields.
+uint32_t swap_payload_prefix(uint32_t value) {
+    if (endian::which() == endian::Arch::little) {
+        return endian::swap_uint32(value);
+    }
+    return value;
+}
+
+// Compresses the payload of the given length in place, using the buffer of at
+// least payload_max_size() bytes as scratch space. Returns false, leaving the
+// payload unchanged, if compression does not make it smaller.
+bool compress_payload(char *payload, size_t &length, char *buffer) {
+    if (length <= compressed_payload_prefix_size()) {
+        return false;
+    }
+
+    // The compressed data must be strictly smaller than the payload.
+    const size_t capacity = length - compressed_payload_prefix_size() - 1;
+    size_t compressed_length = 0;
+    if (!lz4::compress(payload, length, buffer + compressed_payload_prefix_size(),
+                       capacity, compressed_length)) {
+        return false;
+    }
+
+    const uint32_t prefix = swap_payload_prefix(static_cast<uint32_t>(length));
+    std::memcpy(buffer, &prefix, compressed_payload_prefix_size());
+    length = compressed_payload_prefix_size() + compressed_length;
+    std::memcpy(payload, buffer, length);
+    return true;
+}
+
+// Initializes the message with the decompressed payload.
+OneError decompress_payload(Opcode code, const char *payload, size_t length,
+                            PayloadEncoding encoding, Message &message) {
+    if (length < compressed_payload_prefix_size()) {
+        return ONE_ERROR_CODEC_INVALID_COMPRESSED_PAYLOAD;
+    }
+
+    uint32_t prefix = 0;
+    std::memcpy(&prefix, payload, compressed_payload_prefix_size());
+    const size_t decompressed_length = swap_payload_prefix(prefix);
+    if (decompressed_length == 0 || payload_max_size() < decompressed_length) {
+        return ONE_ERROR_CODEC_INVALID_COMPRESSED_PAYLOAD;
+    }
+
+    char *decompressed = nullptr;
+    auto err = message.init(code, decompressed_length, encoding, decompressed);
+    if (is_error(err)) return err;
+
+    if (!lz4::decompress(payload + compressed_payload_prefix_size(),
+                         length - compressed_payload_prefix_size(), decompressed,
+                         decompressed_length)) {
+        return ONE_ERROR_CODEC_INVALID_COMPRESSED_PAYLOAD;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+}  // namespace
+
 const Hello hello = Hello{{'a', 'r', 'c', 0}, (char)0x1, 0};  // namespace codec
 
 bool validate_hello(const Hello &other) {
-    const auto cmp = std::memcmp(&hello, &other, hello_size());
+    // The capabilities are the last field, and are negotiated separately.
+    const auto cmp = std::memcmp(&hello, &other, hello_size() - 1);
     return cmp == 0;
 }
 
@@ -26,13 +127,33 @@ const Hello &valid_hello() {
 bool validate_header(const Header &header) {
     // Minimal validation in the codec at the moment. Opcode will be handled
     // by message layer. Length will be handled by document reader.
-    // Flags are not used at the moment and should be zero.
+    // Flags must be known by this version of the SDK.
     bool is_valid = true;
-    is_valid &= header.flags == (char)0x0;
+    is_valid &= (header.flags & ~header_flag::all) == 0;
     is_valid &= is_opcode_supported(static_cast<Opcode>(header.opcode));
     return is_valid;
 }
 
+PayloadEncoding payload_encoding(char capabilities) {
+    if ((capabilities & capability::msgpack) != 0) {
+        return PayloadEncoding::msgpack;
+    }
+    return PayloadEncoding::json;
+}
+
+EncodeOptions encode_options(char capabilities, size_t compression_threshold,
+                             char *compression_buffer) {
+    // See: https://en.cppreference.com/w/cpp/language/value_initialization
+    // C++11 Value initialization
+    EncodeOptions options{};
+    options.encoding = payload_encoding(capabilities);
+    if ((capabilities & capability::compression) != 0 && compression_buffer != nullptr) {
+        options.compression_threshold = compression_threshold;
+        options.compression_buffer = compression_buffer;
+    }
+    return options;
+}
+
 OneError data_to_message(const void *data, const size_t data_size, size_t &read_data_size,
                       Header &header, Message &message) {
     if (data_size < header_size()) {
@@ -58,17 +179,22 @@ OneError data_to_message(const void *data, const size_t data_size, size_t &read_
 
     read_data_size = total_message_size;
 
-    Payload payload;
-
-    if (0 < header.length) {
-        const size_t payload_length = header.length;
-        const char *payload_data = static_cast<const char *>(data) + codec::header_size();
-        err = payload.from_json({payload_data, payload_length});
-        if (is_error(err)) return err;
-    }
+    // The payload is only copied, or decompressed, here. It is parsed when the
+    // message payload is first read.
+    const size_t payload_length = header.length;
+    const char *payload_data = static_cast<const char *>(data) + codec::header_size();
 
     const Opcode code = static_cast<Opcode>(header.opcode);
-    err = message.init(code, payload);
+    const auto encoding = ((header.flags & header_flag::msgpack) != 0)
+                              ? PayloadEncoding::msgpack
+                              : PayloadEncoding::json;
+    // Empty payloads are not compressed. The hello message notably has none,
+    // its flags hold the accepted capabilities.
+    if ((header.flags & header_flag::compressed) != 0 && payload_length > 0) {
+        err = decompress_payload(code, payload_data, payload_length, encoding, message);
+    } else {
+        err = message.init(code, {payload_data, payload_length}, encoding);
+    }
     if (is_error(err)) {
         message.reset();
         return err;
@@ -78,31 +204,48 @@ OneError data_to_message(const void *data, const size_t data_size, size_t &read_
 }
 
 OneError message_to_data(const uint32_t packet_id, const Message &message,
-                      size_t &data_length,
-                      std::array<char, header_size() + payload_max_size()> &data) {
-    std::array<char, payload_max_size()> payload_data;
+                         const EncodeOptions &options, void *data, size_t capacity,
+                         size_t &data_length) {
+    if (capacity < header_size()) {
+        return ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_PAYLOAD;
+    }
+
+    // Write the payload first, behind the space reserved for the header, since
+    // the header contains the payload length.
+    char *header_data = static_cast<char *>(data);
+    char *payload_data = header_data + header_size();
     size_t payload_length = 0;
-    auto err = payload_to_data(message.payload(), payload_length, payload_data);
+    auto err = payload_to_data(message.payload(), options.encoding, payload_data,
+                               capacity - header_size(), payload_length);
     if (is_error(err)) return err;
 
     // See: https://en.cppreference.com/w/cpp/language/value_initialization
     // C++11 Value initialization
     Header header{};
+    if (options.encoding == PayloadEncoding::msgpack) {
+        header.flags |= header_flag::msgpack;
+    }
+
+    // Large payloads are compressed where written, so small payloads, the vast
+    // majority, are not copied.
+    if (options.compression_threshold != 0 &&
+        options.compression_threshold <= payload_length) {
+        assert(options.compression_buffer != nullptr);
+        if (compress_payload(payload_data, payload_length, options.compression_buffer)) {
+            header.flags |= header_flag::compressed;
+        }
+    }
     header.opcode = static_cast<char>(message.code());
     header.packet_id = packet_id;
     assert(payload_length <= UINT32_MAX);
     header.length = static_cast<uint32_t>(payload_length);
 
-    std::array<char, header_size()> header_data;
-    err = header_to_data(header, header_data);
+    std::array<char, header_size()> swapped_header;
+    err = header_to_data(header, swapped_header);
     if (is_error(err)) return err;
 
+    std::memcpy(header_data, swapped_header.data(), header_size());
     data_length = header_size() + payload_length;
-    std::copy(header_data.cbegin(), header_data.cend(), data.begin());
-
-    if (0 < payload_length) {
-        std::copy_n(payload_data.cbegin(), payload_length, data.begin() + header_size());
-    }
 
     return ONE_ERROR_NONE;
 }
@@ -151,7 +294,8 @@ OneError header_to_data(const Header &header, std::array<char, header_size()> &d
     return ONE_ERROR_NONE;
 }
 
-OneError data_to_payload(const void *data, size_t length, Payload &payload) {
+OneError data_to_payload(const void *data, size_t length, PayloadEncoding encoding,
+                         Payload &payload) {
     if (payload_max_size() < length) {
         return ONE_ERROR_CODEC_INVALID_MESSAGE_PAYLOAD_SIZE_TOO_BIG;
     }
@@ -161,27 +305,45 @@ OneError data_to_payload(const void *data, size_t length, Payload &payload) {
         return ONE_ERROR_NONE;
     }
 
-    auto err = payload.from_json({static_cast<const char *>(data), length});
+    const std::pair<const char *, size_t> bytes{static_cast<const char *>(data), length};
+    auto err = (encoding == PayloadEncoding::msgpack) ? payload.from_msgpack(bytes)
+                                                       : payload.from_json(bytes);
     if (is_error(err)) return err;
 
     return ONE_ERROR_NONE;
 }
 
-OneError payload_to_data(const Payload &payload, size_t &payload_length,
-                      std::array<char, payload_max_size()> &data) {
+OneError payload_to_data(const Payload &payload, PayloadEncoding encoding, void *data,
+                         size_t capacity, size_t &payload_length) {
+    payload_length = 0;
     if (payload.is_empty()) {
-        payload_length = 0;
         return ONE_ERROR_NONE;
     }
 
-    auto str = payload.to_json();
-    payload_length = str.size();
+    // Payloads larger than the maximum are rejected regardless of the space
+    // available.
+    const bool is_capacity_max = payload_max_size() <= capacity;
+    const size_t max_length = is_capacity_max ? payload_max_size() : capacity;
+    const auto overflow_error = is_capacity_max
+                                    ? ONE_ERROR_CODEC_INVALID_MESSAGE_PAYLOAD_SIZE_TOO_BIG
+                                    : ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_PAYLOAD;
+
+    if (encoding == PayloadEncoding::msgpack) {
+        if (!msgpack::write(payload.get(), data, max_length, payload_length)) {
+            return overflow_error;
+        }
+        return ONE_ERROR_NONE;
+    }
 
-    if (payload_max_size() < payload_length) {
-        return ONE_ERROR_CODEC_INVALID_MESSAGE_PAYLOAD_SIZE_TOO_BIG;
+    FixedBufferStream stream(static_cast<char *>(data), max_length);
+    JsonWriter<FixedBufferStream> writer(stream);
+    payload.get().Accept(writer);
+
+    if (stream.overflowed()) {
+        return overflow_error;
     }
 
-    std::memcpy(data.data(), str.c_str(), payload_length);
+    payload_length = stream.size();
     return ONE_ERROR_NONE;
 }
 
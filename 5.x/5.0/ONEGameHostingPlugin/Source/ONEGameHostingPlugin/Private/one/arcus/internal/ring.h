@@ -2,6 +2,9 @@
 #pragma once
 
 #include <assert.h>
+#include <functional>
+#include <new>
+#include <utility>
 
 #include <one/arcus/allocator.h>
 
@@ -9,19 +12,30 @@ namespace i3d {
 namespace one {
 
 // FIFO ring buffer with a fixed capacity.
+//
+// The slots are constructed the first time they are pushed into, and then
+// reused, so that a ring only costs the memory of the values it has held at
+// once. The slots are filled in order from the first, so the constructed ones
+// are always the first _constructed.
 template <typename T>
 class Ring final {
 public:
-    Ring(size_t capacity)
-        : _buffer(nullptr), _capacity(capacity), _size(0), _last(0), _next(0) {
+    // Each slot is constructed with the given arguments.
+    template <class... Args>
+    Ring(size_t capacity, Args &&... args)
+        : _buffer(nullptr)
+        , _capacity(capacity)
+        , _constructed(0)
+        , _construct([args...](T *slot) { ::new (slot) T(args...); })
+        , _size(0)
+        , _last(0)
+        , _next(0) {
         assert(_capacity > 0);
-        void *p = allocator::create_array<T>(_capacity);
-        assert(p);
-        _buffer = reinterpret_cast<T *>(p);
+        _buffer = allocate(_capacity);
     }
     ~Ring() {
         assert(_buffer);
-        allocator::destroy_array<T>(_buffer);
+        destroy(_buffer, _constructed);
         _buffer = nullptr;
     }
 
@@ -36,12 +50,66 @@ public:
     size_t capacity() const {
         return _capacity;
     }
+
+    // Empties the ring, and gives it the capacity and the slot construction
+    // arguments, as the constructor does.
+    template <class... Args>
+    void reset(size_t capacity, Args &&... args) {
+        assert(capacity > 0);
+        destroy(_buffer, _constructed);
+        _buffer = allocate(capacity);
+        _capacity = capacity;
+        _constructed = 0;
+        _construct = [args...](T *slot) { ::new (slot) T(args...); };
+        clear();
+    }
+
+    // Moves the values, oldest first, into a new buffer of the given larger
+    // capacity.
+    void grow(size_t capacity) {
+        assert(capacity > _capacity);
+        T *buffer = allocate(capacity);
+
+        const size_t size = _size;
+        for (size_t i = 0; i < size; ++i) {
+            _construct(&buffer[i]);
+            buffer[i] = std::move(pop());
+        }
+        destroy(_buffer, _constructed);
+        _buffer = buffer;
+        _capacity = capacity;
+        _constructed = size;
+        _size = size;
+        _last = 0;
+        _next = static_cast<unsigned int>(size);
+    }
+
     size_t size() const {
         return _size;
     }
 
     void push(const T &val) {
-        _buffer[_next] = val;
+        next_slot() = val;
+        commit();
+    }
+
+    void push(T &&val) {
+        next_slot() = std::move(val);
+        commit();
+    }
+
+    // Returns the slot the next value will be pushed into, so that it can be
+    // written in place, or null if the ring is full. The value is only pushed
+    // by a following commit.
+    T *reserve() {
+        if (_size == _capacity) {
+            return nullptr;
+        }
+        return &next_slot();
+    }
+
+    // Pushes the value written into the slot returned by reserve.
+    void commit() {
         _next++;
         if (_next >= _capacity) _next = 0;
         if (_size < _capacity) _size++;
@@ -68,10 +136,40 @@ public:
         return _buffer[prev_last];
     }
 
+    // Pops the oldest pushed value by moving it into the given value. Asserts
+    // if size is zero.
+    void pop_into(T &val) {
+        val = std::move(pop());
+    }
+
 private:
+    static T *allocate(size_t capacity) {
+        void *p = allocator::alloc(sizeof(T) * capacity, allocator::Tag::ring);
+        assert(p);
+        return reinterpret_cast<T *>(p);
+    }
+
+    static void destroy(T *buffer, size_t constructed) {
+        for (size_t i = 0; i < constructed; ++i) {
+            buffer[i].~T();
+        }
+        allocator::free(buffer);
+    }
+
+    // The slot at _next, constructed if this is its first use.
+    T &next_slot() {
+        if (_next == _constructed) {
+            _construct(&_buffer[_next]);
+            ++_constructed;
+        }
+        return _buffer[_next];
+    }
+
     T *_buffer;
 
-    const size_t _capacity;
+    size_t _capacity;
+    size_t _constructed;
+    std::function<void(T *)> _construct;
     size_t _size;
 
     unsigned int _last;  // The oldest pushed item that is not yet popped.
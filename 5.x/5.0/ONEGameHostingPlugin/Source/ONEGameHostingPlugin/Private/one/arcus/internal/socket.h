@@ -121,13 +121,18 @@ public:
     // Receives data on the socket into the given buffer, setting the given
     // length_received to the number of bytes received. A failure to due to the
     // socket not being ready, e.g. due to EAGAIN on Linux, is not considered
-    // to be an error and returns ONE_ERROR_NONE.
+    // to be an error and returns ONE_ERROR_NONE, with nothing received.
+    // Returns ONE_ERROR_SOCKET_CLOSED_BY_PEER if the remote end closed the
+    // connection.
     OneError receive(void *data, size_t length, size_t &length_received);
 
     // Error reporting.
     const char *last_error_text() const;
 
 private:
+    // The Poller registers the system socket.
+    friend class Poller;
+
     mutable SOCKET _socket;  // Mutable so that the copy constructor and operator can take
                              // ownership of the system socket.
 
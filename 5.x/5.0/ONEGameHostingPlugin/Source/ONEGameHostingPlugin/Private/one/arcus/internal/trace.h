@@ -0,0 +1,76 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+
+#include <one/arcus/internal/stats.h>
+#include <one/arcus/opcode.h>
+
+// Uncomment, or define for the whole build, to emit the message lifecycle
+// trace events. When undefined, the trace points compile to nothing.
+//#define ONE_ARCUS_TRACING
+
+namespace i3d {
+namespace one {
+
+// Stages of the lifecycle of a message frame. Note these MUST be kept in sync
+// with OneTraceStage in c_api.h.
+enum class TraceStage {
+    // Incoming: the frame's last bytes were received from the socket.
+    receive = 0,
+    // Incoming: the frame's header was decoded and its payload extracted.
+    header_decode,
+    // Incoming: the payload was parsed.
+    payload_parse,
+    // Incoming or outgoing: the message was queued.
+    enqueue,
+    // Incoming: the message is handed to, and returned from, the callbacks.
+    dispatch_start,
+    dispatch_end,
+    // Outgoing: the frame was encoded into the send stream.
+    encode,
+    // Outgoing: the frame's last bytes were sent to the socket.
+    send_complete
+};
+
+// Sends the trace events to a callback, with the packet id and opcode of the
+// frame and a monotonic timestamp in nanoseconds. The callback is invoked on
+// the thread processing the stage, without locks held.
+class Tracer final {
+public:
+    using Callback =
+        std::function<void(void *userdata, TraceStage stage, uint32_t packet_id,
+                           Opcode code, uint64_t nanoseconds)>;
+
+    Tracer() : _callback(nullptr), _userdata(nullptr) {}
+
+    void set_callback(Callback callback, void *userdata) {
+        _callback = callback;
+        _userdata = userdata;
+    }
+
+    void trace(TraceStage stage, uint32_t packet_id, Opcode code) const {
+        trace_at(stage, packet_id, code, stats::now_nanoseconds());
+    }
+
+    void trace_at(TraceStage stage, uint32_t packet_id, Opcode code,
+                  uint64_t nanoseconds) const {
+        if (_callback == nullptr) return;
+        _callback(_userdata, stage, packet_id, code, nanoseconds);
+    }
+
+private:
+    Callback _callback;
+    void *_userdata;
+};
+
+}  // namespace one
+}  // namespace i3d
+
+#ifdef ONE_ARCUS_TRACING
+    #define ONE_ARCUS_TRACE(tracer, stage, message) \
+        (tracer).trace(::i3d::one::TraceStage::stage, (message).packet_id(), (message).code())
+#else
+    #define ONE_ARCUS_TRACE(tracer, stage, message) ((void)0)
+#endif
@@ -0,0 +1,68 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <atomic>
+
+namespace i3d {
+namespace one {
+
+// Publishes the latest value of a writer thread to a reader thread without
+// locks. The writer fills its back buffer and publishes it, and the reader
+// acquires the last published value into its front buffer. A third buffer is
+// exchanged between them, so that neither side ever waits for the other.
+// Values published before the reader acquires them are skipped.
+//
+// Only one thread may write and one thread may read at a time.
+template <typename T>
+class TripleBuffer final {
+public:
+    TripleBuffer() : _buffers(), _back(0), _middle(1), _front(2) {}
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Writer: the buffer to fill before publishing. It holds an older value,
+    // which the writer must fully overwrite.
+    T &back() {
+        return _buffers[_back];
+    }
+
+    // Writer: makes the back buffer the latest value.
+    void publish() {
+        _back = _middle.exchange(_back | dirty_flag, std::memory_order_acq_rel) & index_mask;
+    }
+
+    // Reader: makes the latest value the front buffer, if a value was
+    // published since the last acquire. Returns true if it was.
+    bool acquire() {
+        if (!is_published()) {
+            return false;
+        }
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    // Reader: whether a value was published since the last acquire.
+    bool is_published() const {
+        return (_middle.load(std::memory_order_relaxed) & dirty_flag) != 0;
+    }
+
+    // Reader: the value last acquired.
+    T &front() {
+        return _buffers[_front];
+    }
+
+private:
+    // The middle buffer index is flagged when it holds a value not yet
+    // acquired.
+    static constexpr unsigned index_mask = 0x3;
+    static constexpr unsigned dirty_flag = 0x4;
+
+    T _buffers[3];
+    unsigned _back;
+    std::atomic<unsigned> _middle;
+    unsigned _front;
+};
+
+}  // namespace one
+}  // namespace i3d
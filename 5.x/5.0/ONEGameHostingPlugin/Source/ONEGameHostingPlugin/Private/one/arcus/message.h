@@ -2,34 +2,54 @@
 #pragma once
 
 #include <functional>
+#include <stdint.h>
 #include <utility>
 
 #include <one/arcus/error.h>
 #include <one/arcus/c_platform.h>
-#include <one/arcus/internal/rapidjson/document.h>
+#include <one/arcus/internal/json.h>
 #include <one/arcus/opcode.h>
 #include <one/arcus/types.h>
 
-namespace rapidjson = RAPIDJSON_NAMESPACE;
-
 namespace i3d {
 namespace one {
 
 class Array;
 class Object;
 
+// Encodings of the payload of a message when sent or received.
+enum class PayloadEncoding : char { json, msgpack };
+
 // Payload provides abstraction for JSON data.
 class Payload final {
 public:
     Payload();
+    // Allocates the payload values from the given arena. Clearing the arena
+    // invalidates the payload content, so the payload must be cleared before.
+    explicit Payload(JsonArena *arena);
     Payload(const Payload &other);
     Payload &operator=(const Payload &other);
+    // Moving transfers the content without copying it when both payloads
+    // allocate from the same place, and copies it otherwise. A payload
+    // constructed by moving allocates from its own pool, like a default
+    // constructed one. Unless copied, a moved payload keeps referring to the
+    // data of an in place parse.
+    Payload(Payload &&other);
+    Payload &operator=(Payload &&other);
     ~Payload() = default;
 
     OneError from_json(std::pair<const char *, size_t> data);
     String to_json() const;
 
-    const rapidjson::Value &get() const {
+    // Parses the given null terminated JSON in place. The data is modified, and
+    // the payload strings refer to it, so it must be kept unchanged for as long
+    // as the payload content is used. Copies of the payload own their strings.
+    OneError from_json_insitu(char *data);
+
+    // Reads the payload from the given MessagePack data. Strings are copied.
+    OneError from_msgpack(std::pair<const char *, size_t> data);
+
+    const JsonValue &get() const {
         return _doc;
     }
 
@@ -59,31 +79,88 @@ public:
     OneError set_val_root_object(const Object &val);
 
 private:
-    rapidjson::Document _doc;
+    JsonAllocator _allocator;
+    JsonDocument _doc;
 };
 
+// Message is an Arcus message: an opcode and its payload.
+//
+// A message initialized from received JSON data keeps a copy of the data and
+// only parses it into its payload when the payload is first accessed, so that
+// messages that are never read, e.g. without a registered callback, cost no
+// JSON parsing. The data is parsed in place, the payload strings refer to the
+// message's copy of the data. The data may also be MessagePack, when that
+// encoding was negotiated with the remote end.
 class Message final {
 public:
     Message();
+    // The payload is allocated from the given arena, see Payload.
+    explicit Message(JsonArena *arena);
     Message(const Message &other);
     Message &operator=(const Message &other);
+    // Moving transfers the payload and the received data without copying them,
+    // except for a payload parsed in place, which is copied. The moved from
+    // message is reset.
+    Message(Message &&other);
+    Message &operator=(Message &&other);
     ~Message() = default;
 
-    OneError init(Opcode code, std::pair<const char *, size_t> data);
+    // Copies the given data in the given encoding, which is parsed on first
+    // access to the payload. Parse errors are reported by decode.
+    OneError init(Opcode code, std::pair<const char *, size_t> data,
+                  PayloadEncoding encoding = PayloadEncoding::json);
+    // Like the above, but sets data to non null data of the given length for
+    // the caller to write, e.g. when decompressing received data. The length
+    // must not be zero.
+    OneError init(Opcode code, size_t length, PayloadEncoding encoding, char *&data);
     OneError init(Opcode code, const Payload &payload);
+    OneError init(Opcode code, Payload &&payload);
 
     void reset();
 
+    // Frees the received data buffer of a reset message if its capacity
+    // exceeds max_capacity. A reused message otherwise keeps the capacity of
+    // the largest data it was initialized with. Returns the freed capacity.
+    size_t release_data(size_t max_capacity);
+
+    // Parses the data the message was initialized with, if not yet done, and
+    // returns the parse result. A payload that fails to parse is empty.
+    OneError decode() const;
+
+    // Returns the payload as JSON text. The JSON data the message was
+    // initialized with is returned as is if it has not been parsed yet.
+    String payload_json() const;
+
     Opcode code() const;
     Payload &payload();
     const Payload &payload() const;
 
+    // The packet id of the frame the message was received in, or will be sent
+    // in once queued by a connection. Zero otherwise.
+    uint32_t packet_id() const;
+    void set_packet_id(uint32_t packet_id);
+
 private:
     Opcode _code;
-    Payload _payload;
+    uint32_t _packet_id;
+
+    // The payload and the received data are mutable so that the payload can
+    // be parsed lazily from const accessors.
+    mutable Payload _payload;
+    mutable String _data;
+    PayloadEncoding _encoding;
+    mutable bool _is_decoded;
+    mutable OneError _decode_error;
 };
 
 namespace messages {
+
+// Capacity of the received data kept by the recycled messages of the queues
+// for reuse, 4 KB by default. The data of larger payloads is freed once
+// consumed. Zero restores the default.
+void set_retained_data_capacity(size_t capacity);
+size_t retained_data_capacity();
+
 OneError prepare_soft_stop(int timeout, Message &message);
 OneError prepare_allocated(const Array &array, Message &message);
 OneError prepare_metadata(const Array &array, Message &message);
@@ -7,33 +7,58 @@
 #include <one/arcus/internal/rapidjson/writer.h>
 #include <one/arcus/opcode.h>
 
+#include <atomic>
 #include <cstring>
 
 namespace i3d {
 namespace one {
 
-Object::Object() : _doc(rapidjson::kObjectType) {}
+namespace {
 
-Object::Object(const Object &other) {
+// Last version given to an object, shared so that versions are unique across
+// objects.
+std::atomic<uint64_t> _last_version(0);
+
+uint64_t next_version() {
+    return _last_version.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace
+
+Object::Object() : _doc(rapidjson::kObjectType), _version(0) {}
+
+Object::Object(const Object &other) : _version(other._version) {
     _doc.CopyFrom(other.get(), _doc.GetAllocator());
 }
 
 Object &Object::operator=(const Object &other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    clear();
     _doc.CopyFrom(other.get(), _doc.GetAllocator());
+    _version = other._version;
     return *this;
 }
 
-OneError Object::set(const rapidjson::Value &object) {
+OneError Object::set(const JsonValue &object) {
     if (!object.IsObject()) {
         return ONE_ERROR_OBJECT_WRONG_TYPE_IS_EXPECTING_OBJECT;
     }
 
-    _doc.CopyFrom(object, _doc.GetAllocator());
+    // Const strings are copied since they may refer to the data of an in
+    // place parse, e.g. from a received message payload.
+    clear();
+    _doc.CopyFrom(object, _doc.GetAllocator(), true);
     return ONE_ERROR_NONE;
 }
 
+// The values are dropped before the pool they are allocated from is released.
 void Object::clear() {
     _doc.SetObject();
+    _doc.GetAllocator().release();
+    _version = next_version();
 }
 
 bool Object::is_empty() const {
@@ -51,6 +76,7 @@ OneError Object::remove_key(const char *key) {
     }
 
     _doc.RemoveMember(member);
+    _version = next_version();
     return ONE_ERROR_NONE;
 }
 
@@ -242,7 +268,8 @@ OneError Object::set_val_bool(const char *key, bool val) {
 
     const auto &member = _doc.FindMember(key);
     if (member == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(), val,
+        _version = next_version();
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(), val,
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -252,6 +279,7 @@ OneError Object::set_val_bool(const char *key, bool val) {
         return ONE_ERROR_OBJECT_WRONG_TYPE_IS_EXPECTING_BOOL;
     }
 
+    _version = next_version();
     member->value.SetBool(val);
     return ONE_ERROR_NONE;
 }
@@ -263,7 +291,8 @@ OneError Object::set_val_int(const char *key, int val) {
 
     const auto &member = _doc.FindMember(key);
     if (member == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(), val,
+        _version = next_version();
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(), val,
                        _doc.GetAllocator());
 
         return ONE_ERROR_NONE;
@@ -274,6 +303,7 @@ OneError Object::set_val_int(const char *key, int val) {
         return ONE_ERROR_OBJECT_WRONG_TYPE_IS_EXPECTING_INT;
     }
 
+    _version = next_version();
     member->value.SetInt(val);
     return ONE_ERROR_NONE;
 }
@@ -285,8 +315,9 @@ OneError Object::set_val_string(const char *key, const String &val) {
 
     const auto &member = _doc.FindMember(key);
     if (member == _doc.MemberEnd()) {
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(),
-                       rapidjson::Value(val.c_str(), _doc.GetAllocator()).Move(),
+        _version = next_version();
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(),
+                       JsonValue(val.c_str(), _doc.GetAllocator()).Move(),
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -296,6 +327,7 @@ OneError Object::set_val_string(const char *key, const String &val) {
         return ONE_ERROR_OBJECT_WRONG_TYPE_IS_EXPECTING_STRING;
     }
 
+    _version = next_version();
     member->value.Set(val.c_str());
     return ONE_ERROR_NONE;
 }
@@ -307,9 +339,10 @@ OneError Object::set_val_array(const char *key, const Array &val) {
 
     const auto &member = _doc.FindMember(key);
     if (member == _doc.MemberEnd()) {
-        rapidjson::Value value;
+        JsonValue value;
         value.CopyFrom(val.get(), _doc.GetAllocator());
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(), value,
+        _version = next_version();
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(), value,
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -319,6 +352,7 @@ OneError Object::set_val_array(const char *key, const Array &val) {
         return ONE_ERROR_OBJECT_WRONG_TYPE_IS_EXPECTING_ARRAY;
     }
 
+    _version = next_version();
     member->value.CopyFrom(val.get(), _doc.GetAllocator());
     return ONE_ERROR_NONE;
 }
@@ -330,9 +364,10 @@ OneError Object::set_val_object(const char *key, const Object &val) {
 
     const auto &member = _doc.FindMember(key);
     if (member == _doc.MemberEnd()) {
-        rapidjson::Value value;
+        JsonValue value;
         value.CopyFrom(val.get(), _doc.GetAllocator());
-        _doc.AddMember(rapidjson::Value(key, _doc.GetAllocator()).Move(), value,
+        _version = next_version();
+        _doc.AddMember(JsonValue(key, _doc.GetAllocator()).Move(), value,
                        _doc.GetAllocator());
         return ONE_ERROR_NONE;
     }
@@ -342,6 +377,7 @@ OneError Object::set_val_object(const char *key, const Object &val) {
         return ONE_ERROR_OBJECT_WRONG_TYPE_IS_EXPECTING_OBJECT;
     }
 
+    _version = next_version();
     member->value.CopyFrom(val.get(), _doc.GetAllocator());
     return ONE_ERROR_NONE;
 }
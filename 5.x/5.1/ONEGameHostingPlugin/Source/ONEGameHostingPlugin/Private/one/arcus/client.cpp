@@ -2,9 +2,11 @@
 #include <one/arcus/client.h>
 
 #include <one/arcus/allocator.h>
+#include <one/arcus/internal/codec.h>
 #include <one/arcus/internal/connection.h>
 #include <one/arcus/internal/messages.h>
 #include <one/arcus/opcode.h>
+#include <one/arcus/internal/poller.h>
 #include <one/arcus/internal/socket.h>
 #include <one/arcus/message.h>
 
@@ -26,6 +28,7 @@ constexpr size_t connection_retry_delay_seconds = 5;
 Client::Client()
     : _server_address("")
     , _server_port(0)
+    , _poller(nullptr)
     , _socket(nullptr)
     , _connection(nullptr)
     , _is_connected(false)
@@ -55,6 +58,18 @@ OneError Client::init(const char *address, unsigned int port) {
         return err;
     }
 
+    _poller = allocator::create<Poller>();
+    if (_poller == nullptr) {
+        shutdown();
+        return ONE_ERROR_CLIENT_ALLOCATION_FAILED;
+    }
+
+    err = _poller->init();
+    if (is_error(err)) {
+        shutdown();
+        return err;
+    }
+
     _socket = allocator::create<Socket>();
     if (_socket == nullptr) {
         shutdown();
@@ -67,13 +82,14 @@ OneError Client::init(const char *address, unsigned int port) {
         return err;
     }
 
-    const auto max_incoming = Connection::max_message_default;
-    const auto max_outgoing = Connection::max_message_default;
-    _connection = allocator::create<Connection>(max_incoming, max_outgoing);
+    _connection =
+        allocator::create<Connection>(connection::sizes(MemoryProfile::throughput));
     if (_connection == nullptr) {
         shutdown();
         return ONE_ERROR_VALIDATION_CONNECTION_IS_NULLPTR;
     }
+    // Accept every optional capability offered by the server.
+    _connection->set_supported_capabilities(codec::capability::all);
 
     return ONE_ERROR_NONE;
 }
@@ -93,6 +109,11 @@ void Client::shutdown() {
         _connection = nullptr;
     }
 
+    if (_poller != nullptr) {
+        allocator::destroy<Poller>(_poller);
+        _poller = nullptr;
+    }
+
     shutdown_socket_system();
 
     // See: https://en.cppreference.com/w/cpp/language/value_initialization
@@ -137,6 +158,7 @@ OneError Client::update() {
 #endif
 
         _connection->shutdown();
+        _poller->remove(*_socket);
         _socket->close();
         _is_connected = false;
         _last_connection_attempt_time =
@@ -145,7 +167,12 @@ OneError Client::update() {
         return passthrough_err;
     };
 
-    auto err = _connection->update();
+    auto err = _poller->poll(0);
+    if (is_error(err)) {
+        return err;
+    }
+
+    err = _connection->update();
     // In the case of any error, reset the socket for reconnection attempt.
     if (is_error(err)) {
         return close_client(err);
@@ -210,7 +237,7 @@ OneError Client::send_soft_stop(int timeout) {
 
     Message message;
     messages::prepare_soft_stop(timeout, message);
-    auto err = process_outgoing_message(message);
+    auto err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -223,7 +250,7 @@ OneError Client::send_allocated(Array &data) {
 
     Message message;
     messages::prepare_allocated(data, message);
-    auto err = process_outgoing_message(message);
+    auto err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -236,7 +263,7 @@ OneError Client::send_metadata(Array &data) {
 
     Message message;
     messages::prepare_metadata(data, message);
-    auto err = process_outgoing_message(message);
+    auto err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -249,7 +276,7 @@ OneError Client::send_host_information(Object &data) {
 
     Message message;
     messages::prepare_host_information(data, message);
-    auto err = process_outgoing_message(message);
+    auto err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -262,7 +289,7 @@ OneError Client::send_application_instance_information(Object &data) {
 
     Message message;
     messages::prepare_application_instance_information(data, message);
-    auto err = process_outgoing_message(message);
+    auto err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -275,7 +302,7 @@ OneError Client::send_custom_command(Array &data) {
 
     Message message;
     messages::prepare_custom_command(data, message);
-    auto err = process_outgoing_message(message);
+    auto err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -354,7 +381,7 @@ OneError Client::process_incoming_message(const Message &message) {
     }
 }
 
-OneError Client::process_outgoing_message(const Message &message) {
+OneError Client::process_outgoing_message(Message &&message) {
     OneError err = ONE_ERROR_NONE;
     switch (message.code()) {
         case Opcode::soft_stop: {
@@ -424,7 +451,7 @@ OneError Client::process_outgoing_message(const Message &message) {
         return ONE_ERROR_SERVER_CONNECTION_NOT_READY;
     }
 
-    err = _connection->add_outgoing(message);
+    err = _connection->add_outgoing(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -448,7 +475,12 @@ OneError Client::connect() {
         return err;
     }
 
-    _connection->init(*_socket);
+    err = _poller->add(*_socket);
+    if (is_error(err)) {
+        return err;
+    }
+
+    _connection->init(*_socket, *_poller);
     _is_connected = true;
     return ONE_ERROR_NONE;
 }
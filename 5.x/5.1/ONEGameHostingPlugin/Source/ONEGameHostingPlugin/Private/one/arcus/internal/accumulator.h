@@ -6,22 +6,32 @@
 namespace i3d {
 namespace one {
 
-// Accumulator is fixed-size buffer for accumulating byte data.
-// It adds new data to the end, and removes data from the front.
+// Accumulator is a buffer for accumulating byte data.
+// It adds new data to the end, and removes data from the front. Its capacity
+// only grows when asked to, up to a maximum.
+//
+// Removing data from the front only advances a read offset. The remaining data
+// is moved back to the start of the buffer lazily, when the free space at the
+// end becomes too small, so that the stored data is always contiguous and
+// consuming many small messages from a large buffer stays linear.
 class Accumulator final {
 public:
-    Accumulator(size_t capacity);
+    Accumulator(size_t capacity, size_t max_capacity);
     ~Accumulator();
 
     size_t capacity() const {
         return _capacity;
     }
+    size_t max_capacity() const {
+        return _max_capacity;
+    }
     size_t size() const {
         return _size;
     }
 
     void clear() {
-        trim(size());
+        _begin = 0;
+        _size = 0;
     };
 
     // Copies the given data and adds it to the stream. length must be less than
@@ -31,6 +41,7 @@ public:
     // Provides a pointer to data from the beginning of the stream. Sets the
     // given data pointer to the data. length must be <= size.
     void peek(size_t length, void **data);
+    void peek(size_t length, const void **data) const;
 
     // Drops the number of given bytes from the beginning of the stream, freeing
     // capacity at the end. length must be less than size.
@@ -39,12 +50,39 @@ public:
     // Get is a util equivalent to peek + trim.
     void get(size_t length, void **data);
 
+    // Provides a pointer to the free space at the end of the stream so that
+    // data can be written to it directly, e.g. by a socket receive, and sets
+    // length to its size. The data is added to the stream by a following
+    // commit call.
+    void reserve(void **data, size_t &length);
+
+    // Adds length bytes, written to the space provided by reserve, to the end
+    // of the stream. length must be <= the reserved length.
+    void commit(size_t length);
+
+    // Doubles the capacity, up to the maximum, keeping the stored data.
+    // Returns false if the capacity is already the maximum or the allocation
+    // failed.
+    bool grow();
+
+    // Clears the stream, and reallocates the buffer if its capacity is not the
+    // given one, which must not exceed the maximum.
+    void reset(size_t capacity);
+
 private:
     Accumulator() = delete;
     Accumulator(Accumulator &other) = delete;
 
+    // Moves the stored data to the start of the buffer.
+    void compact();
+
+    // Allocates a buffer of the given capacity holding the stored data.
+    bool reallocate(size_t capacity);
+
     char *_buffer;
     size_t _capacity;
+    const size_t _max_capacity;
+    size_t _begin;  // Offset of the first stored byte in the buffer.
     size_t _size;
 };
 
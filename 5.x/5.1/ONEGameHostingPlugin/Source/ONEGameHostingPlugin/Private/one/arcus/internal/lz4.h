@@ -0,0 +1,29 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <stddef.h>
+
+namespace i3d {
+namespace one {
+
+// Compression in the LZ4 block format, used to compress large Arcus payloads.
+// See https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md. Data
+// compressed here can be decompressed by any LZ4 implementation, and the other
+// way around. The compressor favors speed and simplicity over ratio.
+namespace lz4 {
+
+// Compresses the source into the destination of at most capacity bytes.
+// Returns false if the compressed data does not fit, in which case the content
+// of the destination is undefined.
+bool compress(const void *source, size_t source_size, void *destination,
+              size_t capacity, size_t &destination_size);
+
+// Decompresses the source into the destination, which must be exactly the
+// decompressed size. Returns false if the source is not valid or does not
+// decompress to that size.
+bool decompress(const void *source, size_t source_size, void *destination,
+                size_t destination_size);
+
+}  // namespace lz4
+}  // namespace one
+}  // namespace i3d
@@ -2,6 +2,7 @@
 #include <one/arcus/allocator.h>
 
 #include <assert.h>
+#include <atomic>
 #include <cstdlib>
 
 namespace i3d {
@@ -25,6 +26,48 @@ void *default_realloc(void *p, size_t bytes) {
     return std::realloc(p, bytes);
 }
 
+// Prefix of the tracked allocations, holding their size and tag. Two size_t
+// keep the alignment of the memory that follows.
+constexpr size_t header_size = 2 * sizeof(size_t);
+
+struct TagCounters {
+    std::atomic<uint64_t> live_bytes;
+    std::atomic<uint64_t> peak_bytes;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> frees;
+};
+
+bool _is_tracking = false;
+TagCounters _counters[tag_count()];
+
+void *write_header(void *base, size_t bytes, Tag tag) {
+    size_t *header = reinterpret_cast<size_t *>(base);
+    header[0] = bytes;
+    header[1] = static_cast<size_t>(tag);
+    return header + 2;
+}
+
+size_t *find_header(void *p) {
+    return reinterpret_cast<size_t *>(p) - 2;
+}
+
+void count_alloc(size_t tag, size_t bytes) {
+    auto &counters = _counters[tag];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t live =
+        counters.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = counters.peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !counters.peak_bytes.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void count_free(size_t tag, size_t bytes) {
+    auto &counters = _counters[tag];
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    counters.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
 }  // namespace
 
 // Global allocation overridable functions.
@@ -50,20 +93,71 @@ void reset_overrides() {
     _realloc = default_realloc;
 }
 
-void *alloc(size_t bytes) {
+void set_tracking(bool enabled) {
+    _is_tracking = enabled;
+}
+
+bool is_tracking() {
+    return _is_tracking;
+}
+
+void tag_stats(Tag tag, TagStats &stats) {
+    assert(tag < Tag::count);
+    const auto &counters = _counters[static_cast<size_t>(tag)];
+    stats.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = counters.peak_bytes.load(std::memory_order_relaxed);
+    stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+    stats.frees = counters.frees.load(std::memory_order_relaxed);
+}
+
+void *alloc(size_t bytes, Tag tag) {
     assert(_alloc);
-    void *p = _alloc(bytes);
-    assert(p != nullptr);
-    return p;
+    if (!_is_tracking) {
+        void *p = _alloc(bytes);
+        assert(p != nullptr);
+        return p;
+    }
+
+    void *base = _alloc(header_size + bytes);
+    assert(base != nullptr);
+    if (base == nullptr) {
+        return nullptr;
+    }
+    count_alloc(static_cast<size_t>(tag), bytes);
+    return write_header(base, bytes, tag);
 }
 
 void free(void *p) {
     assert(_free);
-    _free(p);
+    if (!_is_tracking || p == nullptr) {
+        _free(p);
+        return;
+    }
+
+    size_t *header = find_header(p);
+    count_free(header[1], header[0]);
+    _free(header);
 }
 
-void *realloc(void *p, size_t s) {
-    return _realloc(p, s);
+void *realloc(void *p, size_t s, Tag tag) {
+    if (!_is_tracking) {
+        return _realloc(p, s);
+    }
+
+    if (p == nullptr) {
+        return alloc(s, tag);
+    }
+
+    size_t *header = find_header(p);
+    const size_t previous_tag = header[1];
+    const size_t previous_bytes = header[0];
+    void *base = _realloc(header, header_size + s);
+    if (base == nullptr) {
+        return nullptr;
+    }
+    count_free(previous_tag, previous_bytes);
+    count_alloc(previous_tag, s);
+    return write_header(base, s, static_cast<Tag>(previous_tag));
 }
 
 }  // namespace allocator
@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <functional>
+#include <stdint.h>
 
 using std::size_t;
 
@@ -26,27 +27,76 @@ void set_realloc(std::function<void *(void *, size_t)>);
 // Sets the allocators back to the default.
 void reset_overrides();
 
+// The subsystem an allocation is made for, tracked separately. Note these MUST
+// be kept in sync with OneAllocationTag in c_api.h.
+enum class Tag : unsigned char {
+    other = 0,
+    // Connection stream, arena and compression buffers.
+    connection,
+    // Message queue slots.
+    ring,
+    // Message payload documents.
+    payload,
+    // Array and Object handles created through the C API.
+    handle,
+    string,
+    count
+};
+
+constexpr size_t tag_count() {
+    return static_cast<size_t>(Tag::count);
+}
+
+// Allocation counters of a tag, see set_tracking.
+struct TagStats {
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+    uint64_t allocations;
+    uint64_t frees;
+};
+
+// Enables the tracking of the allocations by tag, which prefixes each
+// allocation with its size and tag. Disabled by default. As the overrides, it
+// must be set at init time, before any allocation is made.
+void set_tracking(bool enabled);
+bool is_tracking();
+
+// Copies the counters of the given tag, all zero unless tracking is enabled.
+// Thread-safe.
+void tag_stats(Tag tag, TagStats &stats);
+
 // Use the function set by set_alloc to allocate memory.
-void *alloc(size_t);
+void *alloc(size_t, Tag tag = Tag::other);
 
 // Use the function set by set_free to free memory.
 void free(void *);
 
 // Reallocate existing memory with new size. Must match standard c behavior.
-void *realloc(void *p, size_t s);
+// The memory keeps the tag it was allocated with.
+void *realloc(void *p, size_t s, Tag tag = Tag::other);
 
 // Equivalent to the new operator, but using the function set by set_alloc.
 template <class T, class... Args>
-T *create(Args &&... args) {
-    auto data = alloc(sizeof(T));
+T *create_tagged(Tag tag, Args &&... args) {
+    auto data = alloc(sizeof(T), tag);
     auto p = reinterpret_cast<T *>(data);
     ::new (p) T(std::forward<Args>(args)...);
     return p;
 }
 
+template <class T, class... Args>
+T *create(Args &&... args) {
+    return create_tagged<T>(Tag::other, std::forward<Args>(args)...);
+}
+
 // Equivalent to the delete operator, but using the function set by set_free.
+// Like it, does nothing for null.
 template <class T>
 void destroy(T *p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
     p->~T();
     free(p);
 }
@@ -55,10 +105,10 @@ void destroy(T *p) noexcept {
 // has its constructor called, with the same arguments. The returned memory must
 // be deleted via destroy_array.
 template <class T, class... Args>
-T *create_array(size_t count, Args &&... args) {
+T *create_array_tagged(Tag tag, size_t count, Args &&... args) {
     // Allocate additional space to store the array length.
     size_t padding = sizeof(size_t);
-    auto data = alloc(sizeof(T) * count + padding);
+    auto data = alloc(sizeof(T) * count + padding, tag);
 
     // The padding will be at the front of the data. Set it to the array length.
     size_t *start = reinterpret_cast<size_t *>(data);
@@ -75,6 +125,11 @@ T *create_array(size_t count, Args &&... args) {
     return p;
 }
 
+template <class T, class... Args>
+T *create_array(size_t count, Args &&... args) {
+    return create_array_tagged<T>(Tag::other, count, std::forward<Args>(args)...);
+}
+
 // Deallocates an array using the function set by set_free. Each array element
 // has its destructor called. The destroyed memory must have been allocated via
 // create_array.
@@ -101,19 +156,26 @@ void destroy_array(T *p) noexcept {
 
 }  // namespace allocator
 
-// Custom c++ 11 std::allocator to use for all std types.
-template <class T>
+// Custom c++ 11 std::allocator to use for all std types. The allocations are
+// tracked under the given tag.
+template <class T, allocator::Tag tag = allocator::Tag::other>
 class StandardAllocator {
 public:
     using value_type = T;
 
+    // The tag is not a type parameter, so it is not rebound by default.
+    template <class U>
+    struct rebind {
+        using other = StandardAllocator<U, tag>;
+    };
+
     StandardAllocator() noexcept {}
     template <class U>
-    StandardAllocator(StandardAllocator<U> const &other) noexcept {}
+    StandardAllocator(StandardAllocator<U, tag> const &) noexcept {}
 
     value_type *  // Use pointer if pointer is not a value_type*
     allocate(std::size_t n) {
-        return static_cast<value_type *>(allocator::alloc(n * sizeof(value_type)));
+        return static_cast<value_type *>(allocator::alloc(n * sizeof(value_type), tag));
     }
 
     void deallocate(value_type *p,
@@ -123,13 +185,14 @@ public:
     }
 };
 
-template <class T, class U>
-bool operator==(StandardAllocator<T> const &, StandardAllocator<U> const &) noexcept {
+template <class T, class U, allocator::Tag tag>
+bool operator==(StandardAllocator<T, tag> const &, StandardAllocator<U, tag> const &) noexcept {
     return true;
 }
 
-template <class T, class U>
-bool operator!=(StandardAllocator<T> const &x, StandardAllocator<U> const &y) noexcept {
+template <class T, class U, allocator::Tag tag>
+bool operator!=(StandardAllocator<T, tag> const &x,
+                StandardAllocator<U, tag> const &y) noexcept {
     return !(x == y);
 }
 
@@ -23,6 +23,7 @@ const char *error_text(OneError err) {
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_ARRAY_WRONG_TYPE_IS_EXPECTING_OBJECT)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_ARRAY_WRONG_TYPE_IS_EXPECTING_STRING)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CLIENT_NOT_INITIALIZED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CLIENT_ALLOCATION_FAILED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_HEADER_LENGTH_TOO_SMALL)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_HEADER_LENGTH_TOO_BIG)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_HEADER)},
@@ -31,6 +32,7 @@ const char *error_text(OneError err) {
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_INVALID_MESSAGE_PAYLOAD_SIZE_TOO_BIG)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_INVALID_HEADER)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_TRYING_TO_ENCODE_UNSUPPORTED_OPCODE)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CODEC_INVALID_COMPRESSED_PAYLOAD)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_UNINITIALIZED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_HANDSHAKE_TIMEOUT)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_HEALTH_TIMEOUT)},
@@ -57,6 +59,7 @@ const char *error_text(OneError err) {
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_UNKNOWN_STATUS)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_UPDATE_AFTER_ERROR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_UPDATE_READY_FAIL)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_CONNECTION_CLOSED_BY_PEER)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_MESSAGE_ALLOCATION_FAILED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_MESSAGE_CALLBACK_IS_NULLPTR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_MESSAGE_IS_NULLPTR)},
@@ -109,6 +112,10 @@ const char *error_text(OneError err) {
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_SOCKET_IS_NULLPTR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_OBJECT_ALLOCATION_FAILED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_IS_IN_GROUP)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_NOT_IN_GROUP)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SERVER_TRACING_DISABLED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_ACCEPT_NON_BLOCKING_FAILED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_ACCEPT_UNINITIALIZED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_ADDRESS_FAILED)},
@@ -128,6 +135,13 @@ const char *error_text(OneError err) {
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_SOCKET_OPTIONS_FAILED)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_SYSTEM_CLEANUP_FAIL)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_SYSTEM_INIT_FAIL)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_POLLER_ADD_FAILED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_POLLER_INIT_FAILED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_POLLER_MODIFY_FAILED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_POLLER_REMOVE_FAILED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_POLLER_UNINITIALIZED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_POLLER_WAIT_FAILED)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_SOCKET_CLOSED_BY_PEER)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_ARRAY_IS_NULLPTR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_CALLBACK_IS_NULLPTR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_CAPACITY_IS_NULLPTR)},
@@ -150,7 +164,13 @@ const char *error_text(OneError err) {
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_SIZE_IS_NULLPTR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_VAL_IS_NULLPTR)},
         {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_VAL_SIZE_IS_TOO_SMALL)},
-        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_VERSION_IS_NULLPTR)}};
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_VERSION_IS_NULLPTR)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_ALLOCATION_TAG_IS_INVALID)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_MESSAGE_TYPE_NOT_COALESCABLE)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_INCOMING_OVERFLOW_IS_INVALID)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_MEMORY_SIZES_ARE_INVALID)},
+        {ONE_SYMBOL_STRING_PAIR(ONE_ERROR_VALIDATION_MEMORY_PROFILE_IS_INVALID)}};
     auto it = lookup.find(err);
     if (it == lookup.end()) {
         return "";
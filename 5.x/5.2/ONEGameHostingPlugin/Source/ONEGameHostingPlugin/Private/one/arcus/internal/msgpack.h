@@ -0,0 +1,35 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <stddef.h>
+
+#include <one/arcus/internal/json.h>
+
+namespace i3d {
+namespace one {
+
+// MessagePack encoding of JSON values, used as the binary payload encoding of
+// Arcus messages. See https://github.com/msgpack/msgpack/blob/master/spec.md.
+//
+// Only the types of the JSON model are supported: nil, booleans, integers,
+// floats, strings, arrays and maps with string keys. Binary and extension
+// types are rejected when reading.
+namespace msgpack {
+
+// Maximum nesting of arrays and maps accepted when reading.
+constexpr size_t max_depth() {
+    return 64;
+}
+
+// Writes the value to the given data of at most capacity bytes. Returns false
+// if the value does not fit, in which case the content of data is undefined.
+bool write(const JsonValue &value, void *data, size_t capacity, size_t &length);
+
+// Reads a single value, which must span the given length exactly, into the
+// document. Strings are copied into the document's allocator. Returns false if
+// the data is not valid, in which case the document is unchanged.
+bool read(const void *data, size_t length, JsonDocument &document);
+
+}  // namespace msgpack
+}  // namespace one
+}  // namespace i3d
@@ -0,0 +1,115 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include <one/arcus/allocator.h>
+
+namespace i3d {
+namespace one {
+
+// FIFO ring buffer with a fixed capacity, that one producer thread and one
+// consumer thread can use concurrently without locks. Values are written and
+// read in place in slots that are constructed once and reused, so that steady
+// state use makes no allocations. As in Ring, the slots are only constructed
+// when first reserved, by the producer, before the commit publishing them.
+//
+// The producer only calls reserve and commit, the consumer only peek and pop.
+// Any other function requires both sides to be idle.
+template <typename T>
+class SpscRing final {
+public:
+    // The slots are default constructed.
+    SpscRing(size_t capacity)
+        : _buffer(nullptr), _slots(capacity + 1), _constructed(0), _head(0), _tail(0) {
+        assert(capacity > 0);
+        // One slot always stays free, to tell a full ring from an empty one.
+        void *p = allocator::alloc(sizeof(T) * _slots, allocator::Tag::ring);
+        assert(p);
+        _buffer = reinterpret_cast<T *>(p);
+    }
+    ~SpscRing() {
+        assert(_buffer);
+        for (size_t i = 0; i < _constructed; ++i) {
+            _buffer[i].~T();
+        }
+        allocator::free(_buffer);
+        _buffer = nullptr;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    size_t capacity() const {
+        return _slots - 1;
+    }
+
+    void clear() {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+    }
+
+    // Producer: returns the slot the next value will be pushed into, so that it
+    // can be written in place, or null if the ring is full. The value is only
+    // pushed, and visible to the consumer, after a following commit.
+    T *reserve() {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (next(tail) == _head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        if (tail == _constructed) {
+            ::new (&_buffer[tail]) T();
+            ++_constructed;
+        }
+        return &_buffer[tail];
+    }
+
+    // Producer: pushes the value written into the slot returned by reserve.
+    void commit() {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        _tail.store(next(tail), std::memory_order_release);
+    }
+
+    // Consumer: returns the oldest value, or null if the ring is empty. The
+    // value stays in the ring until popped.
+    T *peek() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &_buffer[head];
+    }
+
+    // Consumer: removes the value returned by peek, handing its slot back to
+    // the producer.
+    void pop() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        assert(head != _tail.load(std::memory_order_acquire));
+        _head.store(next(head), std::memory_order_release);
+    }
+
+private:
+    size_t next(size_t index) const {
+        return (index + 1 == _slots) ? 0 : index + 1;
+    }
+
+    T *_buffer;
+    const size_t _slots;
+    // Only written by the producer.
+    size_t _constructed;
+
+    // Written by the consumer and the producer respectively. Padded apart so
+    // that each side's writes don't invalidate the other's cache line. Padding
+    // is used rather than alignas, since the SDK allocator does not guarantee
+    // over-aligned allocations.
+    char _head_padding[64];
+    std::atomic<size_t> _head;
+    char _tail_padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _tail;
+};
+
+}  // namespace one
+}  // namespace i3d
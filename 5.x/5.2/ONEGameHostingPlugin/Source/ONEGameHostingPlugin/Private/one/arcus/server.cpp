@@ -2,12 +2,18 @@
 #include <one/arcus/server.h>
 
 #include <one/arcus/allocator.h>
+#include <one/arcus/internal/codec.h>
 #include <one/arcus/internal/connection.h>
 #include <one/arcus/internal/messages.h>
 #include <one/arcus/internal/mutex.h>
+#include <one/arcus/internal/poller.h>
 #include <one/arcus/internal/socket.h>
+#include <one/arcus/internal/spsc_ring.h>
 #include <one/arcus/opcode.h>
 #include <one/arcus/message.h>
+#include <one/arcus/server_group.h>
+
+#include <cstring>
 
 #define ONE_ARCUS_SERVER_LOGGING
 
@@ -16,7 +22,19 @@ namespace one {
 
 namespace {
 size_t listen_retry_delay_seconds = 60;
-}
+
+// Longest wait of the I/O thread for socket activity. Outgoing messages queued
+// by the game thread are sent after at most this delay.
+constexpr int io_thread_poll_timeout_ms = 10;
+
+// Capacity of the queues between the game and I/O threads. Received messages
+// stay in the connection when the game thread falls behind.
+constexpr size_t io_queue_size = Connection::max_message_default * 4;
+
+// Longest wait, so that the handshake and health check timers of the
+// connection, the shortest being one second, are still checked in time.
+constexpr int max_wait_timeout_ms = 1000;
+}  // namespace
 
 namespace server {
 // For testing.
@@ -25,27 +43,19 @@ void set_listen_retry_delay(size_t seconds) {
 }
 }  // namespace server
 
-bool Server::game_states_changed(Server::GameState &new_state,
-                                 Server::GameState &old_state) {
-    if (new_state.players != old_state.players) {
-        return true;
-    }
-    if (new_state.max_players != old_state.max_players) {
-        return true;
+unsigned Server::GameStateDigest::changed_fields(const GameStateDigest &other) const {
+    unsigned fields = 0;
+    if (players != other.players) fields |= live_state_players;
+    if (max_players != other.max_players) fields |= live_state_max_players;
+    if (name != other.name) fields |= live_state_name;
+    if (map != other.map) fields |= live_state_map;
+    if (mode != other.mode) fields |= live_state_mode;
+    if (version != other.version) fields |= live_state_version;
+    if (additional_data != other.additional_data ||
+        has_additional_data != other.has_additional_data) {
+        fields |= live_state_additional_data;
     }
-    if (new_state.name != old_state.name) {
-        return true;
-    }
-    if (new_state.map != old_state.map) {
-        return true;
-    }
-    if (new_state.mode != old_state.mode) {
-        return true;
-    }
-    if (new_state.version != old_state.version) {
-        return true;
-    }
-    return false;
+    return fields;
 }
 
 // See: https://en.cppreference.com/w/cpp/language/value_initialization
@@ -53,18 +63,58 @@ bool Server::game_states_changed(Server::GameState &new_state,
 Server::Server()
     : _listen_port(0)
     , _is_listening(false)
+    , _poller(nullptr)
     , _listen_socket(nullptr)
     , _client_socket(nullptr)
     , _client_connection(nullptr)
     , _is_waiting_for_client(false)
-    , _game_state()
+    , _is_msgpack_enabled(false)
+    , _compression_threshold(0)
+    , _is_coalescing()
+    , _coalescing_interval_ms()
+    , _incoming_overflow(IncomingOverflow::pause)
+    , _max_incoming_messages(Connection::max_message_default)
+    , _stream_size(connection::sizes(MemoryProfile::throughput).stream_size)
+    , _incoming_arena_size(connection::sizes(MemoryProfile::throughput).incoming_arena_size)
+    , _max_messages_in(connection::sizes(MemoryProfile::throughput).max_messages_in)
+    , _max_messages_out(connection::sizes(MemoryProfile::throughput).max_messages_out)
+    , _live_state_writer()
+    , _live_state()
+    , _last_written_game_state()
+    , _last_written_name()
+    , _last_written_map()
+    , _last_written_mode()
+    , _last_written_version()
+    , _last_string_version(0)
     , _last_sent_game_state()
     , _game_state_was_set(false)
     , _status(ApplicationInstanceStatus::starting)
     , _should_send_status(false)
     , _callbacks{}
     , _last_listen_attempt_time(std::chrono::steady_clock::duration::zero())
-    , _additional_data(nullptr) {}
+    , _waiter()
+    , _wait_condition()
+    , _is_woken(false)
+    , _is_waiting(false)
+    , _io_thread()
+    , _is_io_thread_running(false)
+    , _io_events(nullptr)
+    , _io_commands(nullptr)
+    , _io_status(Status::uninitialized)
+    , _io_error(ONE_ERROR_NONE)
+    , _is_ready_event_pending(false)
+    , _has_forwarded_events(false)
+    , _stats()
+    , _dispatch_stats()
+    , _io_stats()
+    , _tracer()
+    , _group(nullptr)
+    , _is_scheduled(false)
+    , _group_update_count(0) {
+    for (size_t i = 0; i < connection::coalesced_opcode_count(); ++i) {
+        _is_coalescing[i] = connection::is_coalesced_by_default(i);
+    }
+}
 
 Server::~Server() {
     shutdown();
@@ -74,13 +124,139 @@ void Server::set_logger(const Logger &logger) {
     _logger = logger;
 }
 
+OneError Server::set_tracer(const Tracer &tracer) {
+#ifdef ONE_ARCUS_TRACING
+    const std::lock_guard<std::mutex> lock(_server);
+    _tracer = tracer;
+    if (_client_connection != nullptr) {
+        _client_connection->set_tracer(tracer);
+    }
+    return ONE_ERROR_NONE;
+#else
+    (void)tracer;
+    return ONE_ERROR_SERVER_TRACING_DISABLED;
+#endif
+}
+
+void Server::set_msgpack_payloads(bool enabled) {
+    const std::lock_guard<std::mutex> lock(_server);
+    _is_msgpack_enabled = enabled;
+}
+
+void Server::set_compression_threshold(unsigned int threshold) {
+    const std::lock_guard<std::mutex> lock(_server);
+    _compression_threshold = threshold;
+}
+
+OneError Server::set_coalescing(Opcode code, bool enabled, unsigned int min_interval_ms) {
+    const size_t index = connection::coalesced_index(code);
+    if (index == connection::coalesced_opcode_count()) {
+        return ONE_ERROR_VALIDATION_MESSAGE_TYPE_NOT_COALESCABLE;
+    }
+
+    const std::lock_guard<std::mutex> lock(_server);
+    _is_coalescing[index] = enabled;
+    _coalescing_interval_ms[index] = min_interval_ms;
+    return ONE_ERROR_NONE;
+}
+
+void Server::set_incoming_overflow(IncomingOverflow policy, unsigned int max_messages) {
+    const std::lock_guard<std::mutex> lock(_server);
+    _incoming_overflow = policy;
+    _max_incoming_messages = max_messages;
+}
+
+OneError Server::set_memory_sizes(const connection::Sizes &sizes) {
+    if (!connection::is_valid(sizes)) {
+        return ONE_ERROR_VALIDATION_MEMORY_SIZES_ARE_INVALID;
+    }
+
+    const std::lock_guard<std::mutex> lock(_server);
+    _stream_size = sizes.stream_size;
+    _incoming_arena_size = sizes.incoming_arena_size;
+    _max_messages_in = sizes.max_messages_in;
+    _max_messages_out = sizes.max_messages_out;
+    return ONE_ERROR_NONE;
+}
+
+OneError Server::set_memory_profile(MemoryProfile profile) {
+    return set_memory_sizes(connection::sizes(profile));
+}
+
+OneError Server::set_io_thread(bool enabled) {
+    const std::lock_guard<std::mutex> lock(_server);
+
+    if (!is_initialized()) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    if (_group != nullptr) {
+        return ONE_ERROR_SERVER_IS_IN_GROUP;
+    }
+
+    if (!enabled) {
+        stop_io_thread();
+        return ONE_ERROR_NONE;
+    }
+
+    if (_io_thread.joinable()) {
+        return ONE_ERROR_NONE;
+    }
+
+    if (_io_events == nullptr) {
+        _io_events = allocator::create<SpscRing<Message>>(io_queue_size);
+        _io_commands = allocator::create<SpscRing<Message>>(io_queue_size);
+        if (_io_events == nullptr || _io_commands == nullptr) {
+            return ONE_ERROR_SERVER_ALLOCATION_FAILED;
+        }
+    }
+
+    _io_status = connection_status();
+    _io_error = ONE_ERROR_NONE;
+    socket_stats(_io_stats.back());
+    _io_stats.publish();
+    _is_ready_event_pending = false;
+    // Received messages are only dispatched by the game thread, an overflow
+    // pauses the reading instead.
+    _client_connection->set_incoming_dispatcher(nullptr);
+    _is_io_thread_running = true;
+    _io_thread = std::thread(&Server::io_thread_loop, this);
+    return ONE_ERROR_NONE;
+}
+
+void Server::stop_io_thread() {
+    if (!_io_thread.joinable()) {
+        return;
+    }
+
+    _is_io_thread_running = false;
+    _io_thread.join();
+    _client_connection->set_incoming_dispatcher(
+        [this](const Message &message) { return dispatch_received_message(message); });
+
+    // The sockets and connection are back to this thread. Hand over what the
+    // I/O thread had not yet processed.
+    if (_is_ready_event_pending) {
+        _is_ready_event_pending = false;
+        _last_sent_game_state = GameStateDigest();
+        _game_state_was_set = true;
+        _should_send_status = true;
+    }
+    const bool is_ready = _client_connection->status() == Connection::Status::ready;
+    auto err = forward_io_commands(is_ready);
+    if (is_error(err)) {
+        close_client_connection();
+    }
+    _io_status = Status::uninitialized;
+}
+
 OneError Server::init(unsigned int listen_port) {
     const std::lock_guard<std::mutex> lock(_server);
 
     _listen_port = listen_port;
 
     if (_listen_socket != nullptr || _client_socket != nullptr ||
-        _client_connection != nullptr) {
+        _client_connection != nullptr || _poller != nullptr) {
         return ONE_ERROR_SERVER_ALREADY_INITIALIZED;
     }
 
@@ -89,36 +265,82 @@ OneError Server::init(unsigned int listen_port) {
         return err;
     }
 
+    {
+        const std::lock_guard<std::mutex> waiter_lock(_waiter);
+        _poller = allocator::create<Poller>();
+    }
+    if (_poller == nullptr) {
+        return ONE_ERROR_SERVER_ALLOCATION_FAILED;
+    }
+
+    err = _poller->init();
+    if (is_error(err)) {
+        shutdown_server();
+        return err;
+    }
+
+    return init_sockets();
+}
+
+OneError Server::init_in_group(unsigned int listen_port, ServerGroup &group,
+                               Poller &poller, char *compression_buffer) {
+    const std::lock_guard<std::mutex> lock(_server);
+
+    _listen_port = listen_port;
+
+    if (_listen_socket != nullptr || _client_socket != nullptr ||
+        _client_connection != nullptr || _poller != nullptr) {
+        return ONE_ERROR_SERVER_ALREADY_INITIALIZED;
+    }
+
+    auto err = init_socket_system();
+    if (is_error(err)) {
+        return err;
+    }
+
+    _group = &group;
+    {
+        const std::lock_guard<std::mutex> waiter_lock(_waiter);
+        _poller = &poller;
+    }
+
+    err = init_sockets();
+    if (is_error(err) && err != ONE_ERROR_SOCKET_BIND_FAILED) {
+        // The group only keeps servers that were added.
+        shutdown_server();
+        return err;
+    }
+
+    _client_connection->set_compression_buffer(compression_buffer);
+    return err;
+}
+
+OneError Server::init_sockets() {
     _listen_socket = allocator::create<Socket>();
     if (_listen_socket == nullptr) {
         return ONE_ERROR_SERVER_SOCKET_ALLOCATION_FAILED;
     }
 
-    err = _listen_socket->init();
+    auto err = _listen_socket->init();
     if (is_error(err)) {
-        shutdown();
+        shutdown_server();
         return err;
     }
 
     _client_socket = allocator::create<Socket>();
     if (_client_socket == nullptr) {
-        shutdown();
+        shutdown_server();
         return ONE_ERROR_SERVER_SOCKET_ALLOCATION_FAILED;
     }
 
-    _additional_data = allocator::create<Object>();
-    if (_additional_data == nullptr) {
-        shutdown();
-        return ONE_ERROR_SERVER_OBJECT_ALLOCATION_FAILED;
-    }
-
-    const auto max_incoming = Connection::max_message_default;
-    const auto max_outgoing = Connection::max_message_default;
-    _client_connection = allocator::create<Connection>(max_incoming, max_outgoing);
+    _client_connection = allocator::create<Connection>(memory_sizes());
     if (_client_connection == nullptr) {
-        shutdown();
+        shutdown_server();
         return ONE_ERROR_SERVER_CONNECTION_IS_NULLPTR;
     }
+    _client_connection->set_tracer(_tracer);
+    _client_connection->set_incoming_dispatcher(
+        [this](const Message &message) { return dispatch_received_message(message); });
 
     // Attempt to start listening at init time, but if port binding fails then
     // update will try to listen again periodically, so punt the bind error
@@ -132,9 +354,43 @@ OneError Server::init(unsigned int listen_port) {
 }
 
 OneError Server::shutdown() {
+    ServerGroup *group = _group;
+    if (group != nullptr) {
+        return group->remove(*this);
+    }
+
     _logger.Log(LogLevel::Info, "server is shutting down");
 
     const std::lock_guard<std::mutex> lock(_server);
+    return shutdown_server();
+}
+
+OneError Server::shutdown_server() {
+
+    stop_io_thread();
+
+    if (_io_events != nullptr) {
+        allocator::destroy<SpscRing<Message>>(_io_events);
+        _io_events = nullptr;
+    }
+
+    if (_io_commands != nullptr) {
+        allocator::destroy<SpscRing<Message>>(_io_commands);
+        _io_commands = nullptr;
+    }
+
+    // The sockets are unregistered from a group's poller, which outlives them.
+    if (_group != nullptr && _poller != nullptr) {
+        if (_listen_socket != nullptr && _is_listening) {
+            _poller->remove(*_listen_socket);
+        }
+        if (_client_socket != nullptr && _client_socket->is_initialized()) {
+            _poller->remove(*_client_socket);
+        }
+    }
+    _is_listening = false;
+    _stats = Stats();
+    _dispatch_stats = Stats();
 
     if (_client_connection != nullptr) {
         allocator::destroy<Connection>(_client_connection);
@@ -151,10 +407,15 @@ OneError Server::shutdown() {
         _client_socket = nullptr;
     }
 
-    if (_additional_data != nullptr) {
-        allocator::destroy<Object>(_additional_data);
-        _additional_data = nullptr;
+    if (_poller != nullptr) {
+        const std::lock_guard<std::mutex> waiter_lock(_waiter);
+        if (_group == nullptr) {
+            allocator::destroy<Poller>(_poller);
+        }
+        _poller = nullptr;
     }
+    _group = nullptr;
+    _is_scheduled = false;
 
     shutdown_socket_system();
     ServerCallbacks cb{};
@@ -185,6 +446,14 @@ Server::Status Server::status() const {
 
     if (!is_initialized()) return Status::uninitialized;
 
+    if (_io_thread.joinable()) return _io_status;
+
+    return connection_status();
+}
+
+Server::Status Server::connection_status() const {
+    if (!is_initialized()) return Status::uninitialized;
+
     if (_is_waiting_for_client) return Status::waiting_for_client;
 
     if (_listen_socket->is_initialized() && !_is_waiting_for_client &&
@@ -247,6 +516,11 @@ OneError Server::listen() {
         return err;
     }
 
+    err = _poller->add(*_listen_socket, this);
+    if (is_error(err)) {
+        return err;
+    }
+
     _is_listening = true;
     _is_waiting_for_client = true;
 
@@ -267,19 +541,14 @@ OneError Server::update_listen_socket() {
         }
     }
 
-    bool is_ready;
-    auto err = _listen_socket->ready_for_read(0.f, is_ready);
-    if (is_error(err)) {
-        return err;
-    }
-    if (!is_ready) {
+    if (!_poller->is_readable(*_listen_socket)) {
         return ONE_ERROR_NONE;
     }
 
     String client_ip;
     unsigned int client_port;
     Socket incoming_client;
-    err = _listen_socket->accept(incoming_client, client_ip, client_port);
+    auto err = _listen_socket->accept(incoming_client, client_ip, client_port);
     if (is_error(err)) {
         return ONE_ERROR_NONE;
     }
@@ -299,7 +568,25 @@ OneError Server::update_listen_socket() {
     _is_waiting_for_client = false;
 
     *_client_socket = incoming_client;
-    _client_connection->init(*_client_socket);
+    err = _poller->add(*_client_socket, this);
+    if (is_error(err)) {
+        _client_socket->close();
+        _is_waiting_for_client = true;
+        return err;
+    }
+    char capabilities = codec::capability::none;
+    if (_is_msgpack_enabled) capabilities |= codec::capability::msgpack;
+    if (_compression_threshold != 0) capabilities |= codec::capability::compression;
+    _client_connection->set_supported_capabilities(capabilities);
+    _client_connection->set_compression_threshold(_compression_threshold);
+    for (size_t i = 0; i < connection::coalesced_opcode_count(); ++i) {
+        _client_connection->set_coalescing(connection::coalesced_opcode(i),
+                                           _is_coalescing[i], _coalescing_interval_ms[i]);
+    }
+    _client_connection->set_sizes(memory_sizes());
+    _client_connection->set_incoming_overflow(_incoming_overflow, _max_incoming_messages);
+    _client_connection->init(*_client_socket, *_poller);
+    ++_stats.connections;
 
     // The Arcus Server is responsible for initiating the handshake against agents.
     // The agent waits for an initial hello packet from the Server.
@@ -308,6 +595,48 @@ OneError Server::update_listen_socket() {
     return ONE_ERROR_NONE;
 }
 
+OneError Server::stats(Stats &stats) {
+    const std::lock_guard<std::mutex> lock(_server);
+
+    if (!is_initialized()) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    if (_io_thread.joinable()) {
+        _io_stats.acquire();
+        stats = _io_stats.front();
+    } else {
+        socket_stats(stats);
+    }
+    stats.add(_dispatch_stats);
+    return ONE_ERROR_NONE;
+}
+
+void Server::socket_stats(Stats &stats) const {
+    stats = _client_connection->stats();
+    stats.add(_stats);
+}
+
+OneError Server::dispatch_incoming_message(const Message &message) {
+    ONE_ARCUS_TRACE(_tracer, dispatch_start, message);
+    const uint64_t start = stats::now_nanoseconds();
+    auto err = process_incoming_message(message);
+    ++_dispatch_stats.callbacks;
+    _dispatch_stats.callback_nanoseconds += stats::now_nanoseconds() - start;
+    ONE_ARCUS_TRACE(_tracer, dispatch_end, message);
+    return err;
+}
+
+OneError Server::dispatch_received_message(const Message &message) {
+#ifdef ONE_ARCUS_TRACING
+    // Parsed ahead of the callbacks, which otherwise parse it, so that parsing
+    // is traced on its own.
+    message.decode();
+    ONE_ARCUS_TRACE(_tracer, payload_parse, message);
+#endif
+    return dispatch_incoming_message(message);
+}
+
 OneError Server::process_incoming_message(const Message &message) {
     // Unlock and relock the server mutex when processing incoming messages to
     // allow the callback to be re-entrant on server functions (e.g. to send
@@ -317,7 +646,7 @@ OneError Server::process_incoming_message(const Message &message) {
 #ifdef ONE_ARCUS_SERVER_LOGGING
     OStringStream stream;
     stream << "incoming opcode: " << static_cast<int>(message.code())
-           << ", payload: " << message.payload().to_json();
+           << ", payload: " << message.payload_json();
     _logger.Log(LogLevel::Info, stream.str());
 #endif
 
@@ -370,11 +699,11 @@ OneError Server::process_incoming_message(const Message &message) {
     }
 }
 
-OneError Server::process_outgoing_message(const Message &message) {
+OneError Server::process_outgoing_message(Message &&message) {
 #ifdef ONE_ARCUS_SERVER_LOGGING
     OStringStream stream;
     stream << "outgoing opcode: " << static_cast<int>(message.code())
-           << ", payload: " << message.payload().to_json();
+           << ", payload: " << message.payload_json();
     _logger.Log(LogLevel::Info, stream.str());
 #endif
 
@@ -411,6 +740,23 @@ OneError Server::process_outgoing_message(const Message &message) {
             return ONE_ERROR_NONE;
     }
 
+    // The I/O thread sends the message.
+    if (_io_thread.joinable()) {
+        if (_io_status != Status::ready) {
+            return ONE_ERROR_SERVER_CONNECTION_NOT_READY;
+        }
+
+        Message *command = _io_commands->reserve();
+        if (command == nullptr) {
+            return ONE_ERROR_CONNECTION_OUTGOING_QUEUE_INSUFFICIENT_SPACE;
+        }
+        *command = std::move(message);
+        _io_commands->commit();
+        // Sent now rather than at the end of the I/O thread's poll timeout.
+        _poller->wake();
+        return ONE_ERROR_NONE;
+    }
+
     if (_client_connection == nullptr) {
         return ONE_ERROR_SERVER_CONNECTION_IS_NULLPTR;
     }
@@ -420,7 +766,7 @@ OneError Server::process_outgoing_message(const Message &message) {
         return ONE_ERROR_SERVER_CONNECTION_NOT_READY;
     }
 
-    err = _client_connection->add_outgoing(message);
+    err = _client_connection->add_outgoing(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -428,8 +774,18 @@ OneError Server::process_outgoing_message(const Message &message) {
     return ONE_ERROR_NONE;
 }
 
+connection::Sizes Server::memory_sizes() const {
+    connection::Sizes sizes;
+    sizes.stream_size = _stream_size;
+    sizes.incoming_arena_size = _incoming_arena_size;
+    sizes.max_messages_in = _max_messages_in;
+    sizes.max_messages_out = _max_messages_out;
+    return sizes;
+}
+
 void Server::close_client_connection() {
     _client_connection->shutdown();
+    _poller->remove(*_client_socket);
     _client_socket->close();
     _is_waiting_for_client = true;
 
@@ -443,7 +799,7 @@ void Server::close_client_connection() {
 #endif
 }
 
-OneError Server::update_client_connection() {
+OneError Server::update_client_connection(bool is_io_thread) {
     // If any errors are encountered while updating the connection, then close
     // the connection and socket. The client is expected to reconnect.
     auto fail = [this](const OneError passthrough_err) -> OneError {
@@ -466,14 +822,23 @@ OneError Server::update_client_connection() {
 
         if (count == 0) break;
 
+        // Received messages wait in the connection until the game thread
+        // catches up.
+        if (is_io_thread && _io_events->reserve() == nullptr) break;
+
 #ifdef ONE_ARCUS_SERVER_LOGGING
         OStringStream stream;
         stream << "server processing incoming messages: " << count;
         _logger.Log(LogLevel::Info, stream.str());
 #endif
 
-        err = _client_connection->remove_incoming(
-            [this](const Message &message) { return process_incoming_message(message); });
+        if (is_io_thread) {
+            err = _client_connection->remove_incoming(
+                [this](const Message &message) { return forward_incoming_message(message); });
+        } else {
+            err = _client_connection->remove_incoming(
+                [this](const Message &message) { return dispatch_received_message(message); });
+        }
         if (is_error(err)) return fail(err);
     }
 
@@ -489,7 +854,37 @@ OneError Server::update() {
 
     assert(_client_socket != nullptr);
     assert(_client_connection != nullptr);
+    assert(_poller != nullptr);
+
+    if (_group != nullptr) {
+        return ONE_ERROR_SERVER_IS_IN_GROUP;
+    }
+
+    if (_io_thread.joinable()) {
+        return update_from_io_thread();
+    }
+
+    // Messages forwarded by a stopped I/O thread are processed first.
+    if (_io_events != nullptr) {
+        auto err = dispatch_io_events();
+        if (is_error(err)) {
+            return err;
+        }
+    }
+
+    // Gather the readiness of the listen and client sockets with a single
+    // system call. The listen socket and connection only act on the sockets
+    // reported as ready.
+    auto err = _poller->poll(0);
+    ++_stats.poll_calls;
+    if (is_error(err)) {
+        return err;
+    }
 
+    return update_sockets();
+}
+
+OneError Server::update_sockets() {
     auto err = update_listen_socket();
     if (is_error(err)) {
         return err;
@@ -502,66 +897,415 @@ OneError Server::update() {
 
     const bool was_ready = (_client_connection->status() == Connection::Status::ready);
 
-    if (was_ready && _game_state_was_set) {
-        if (game_states_changed(_game_state, _last_sent_game_state)) {
-            if (_client_connection->status() == Connection::Status::ready) {
-                err = send_live_state();
-                if (is_error(err)) {
-                    close_client_connection();
-                    return err;
-                }
-                _game_state_was_set = false;
-                _last_sent_game_state = _game_state;
+    if (was_ready) {
+        err = send_pending_state();
+        if (is_error(err)) {
+            close_client_connection();
+            return err;
+        }
+    }
+
+    err = update_client_connection(false);
+    if (is_error(err)) {
+        return err;
+    }
+
+    const bool is_ready = (_client_connection->status() == Connection::Status::ready);
+    if (is_ready && !was_ready) {
+        // Schedule a send when connection is established to ensure newly
+        // connected client has the correct state.
+        _last_sent_game_state = GameStateDigest();
+        _game_state_was_set = true;
+        _should_send_status = true;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+OneError Server::update_in_group() {
+    const std::lock_guard<std::mutex> lock(_server);
+
+    if (!is_initialized()) {
+        return ONE_ERROR_NONE;
+    }
+
+    // Properties set during the update schedule the server again.
+    _is_scheduled = false;
+    auto err = update_sockets();
+    if (has_pending_work()) {
+        wake_waiter();
+    }
+    return err;
+}
+
+OneError Server::send_pending_state() {
+    if (_live_state.acquire()) {
+        _game_state_was_set = true;
+    }
+
+    if (_game_state_was_set) {
+        GameState &state = _live_state.front();
+        if (state.digest.changed_fields(_last_sent_game_state) != 0) {
+            auto err = send_live_state();
+            if (is_error(err)) {
+                return err;
             }
+            _game_state_was_set = false;
+            _last_sent_game_state = state.digest;
         } else {
             _game_state_was_set = false;
         }
     }
-    if (was_ready && _should_send_status) {
-        err = send_application_instance_status();
+
+    if (_should_send_status) {
+        auto err = send_application_instance_status();
         if (is_error(err)) {
-            close_client_connection();
             return err;
         }
         _should_send_status = false;
     }
 
-    err = update_client_connection();
+    return ONE_ERROR_NONE;
+}
+
+bool Server::has_pending_work() const {
+    if (_io_thread.joinable()) {
+        if (_io_error.load() != ONE_ERROR_NONE) return true;
+        if (_io_events->peek() != nullptr) return true;
+        if (_io_status != Status::ready) return false;
+    } else {
+        // Messages forwarded by a stopped I/O thread.
+        if (_io_events != nullptr && _io_events->peek() != nullptr) return true;
+        if (!_client_socket->is_initialized() ||
+            _client_connection->status() != Connection::Status::ready) {
+            return false;
+        }
+        // Incoming messages the poller will not report, see
+        // Connection::has_pending_incoming.
+        if (_client_connection->has_pending_incoming()) return true;
+    }
+
+    return _live_state.is_published() || _game_state_was_set || _should_send_status;
+}
+
+OneError Server::wait(int timeout_ms) {
+    if (timeout_ms < 0 || timeout_ms > max_wait_timeout_ms) {
+        timeout_ms = max_wait_timeout_ms;
+    }
+
+    std::unique_lock<std::mutex> lock(_server);
+
+    if (!is_initialized()) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    if (_group != nullptr) {
+        return ONE_ERROR_SERVER_IS_IN_GROUP;
+    }
+
+    {
+        const std::lock_guard<std::mutex> waiter_lock(_waiter);
+        _is_woken = false;
+    }
+
+    // Pairs with the fence in wake_waiter: either the setter sees the waiting
+    // flag and wakes, or the pending work is seen here.
+    _is_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    OneError err = ONE_ERROR_NONE;
+    if (has_pending_work()) {
+        // Nothing to wait for.
+    } else if (_io_thread.joinable()) {
+        lock.unlock();
+        std::unique_lock<std::mutex> waiter_lock(_waiter);
+        _wait_condition.wait_for(waiter_lock, std::chrono::milliseconds(timeout_ms),
+                                 [this]() { return _is_woken; });
+    } else {
+        // Coalesced messages waiting for their interval are sent by the update
+        // following it.
+        const int delay_ms = _client_connection->next_send_delay_ms();
+        if (delay_ms >= 0 && delay_ms < timeout_ms) {
+            timeout_ms = delay_ms;
+        }
+
+        // Other threads may set properties during the wait, the poller is
+        // only destroyed by shutdown.
+        Poller *poller = _poller;
+        lock.unlock();
+        err = poller->wait(timeout_ms);
+    }
+
+    _is_waiting.store(false, std::memory_order_relaxed);
+    return err;
+}
+
+void Server::wake() {
+    const std::lock_guard<std::mutex> lock(_waiter);
+    _is_woken = true;
+    _wait_condition.notify_one();
+    if (_poller != nullptr) {
+        _poller->wake();
+    }
+}
+
+void Server::wake_waiter() {
+    ServerGroup *group = _group;
+    if (group != nullptr) {
+        group->schedule(*this);
+        return;
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_is_waiting.load(std::memory_order_relaxed)) {
+        wake();
+    }
+}
+
+OneError Server::descriptor(int &descriptor) const {
+    const std::lock_guard<std::mutex> lock(_server);
+
+    if (!is_initialized()) {
+        return ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED;
+    }
+
+    if (_group != nullptr) {
+        return ONE_ERROR_SERVER_IS_IN_GROUP;
+    }
+
+    if (_io_thread.joinable()) {
+        return ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE;
+    }
+
+    descriptor = _poller->descriptor();
+    if (descriptor < 0) {
+        return ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE;
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+void Server::io_thread_loop() {
+    while (_is_io_thread_running) {
+        // Polling returns immediately without registered sockets.
+        if (!_is_listening) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(io_thread_poll_timeout_ms));
+        }
+
+        const Status previous_status = _io_status;
+        _has_forwarded_events = false;
+        auto err = update_io_thread();
+        if (is_error(err)) {
+            _io_error = err;
+        }
+        _io_status = connection_status();
+        socket_stats(_io_stats.back());
+        _io_stats.publish();
+
+        if (_has_forwarded_events || is_error(err) || _io_status != previous_status) {
+            wake_waiter();
+        }
+    }
+}
+
+OneError Server::update_io_thread() {
+    // Incoming messages the poller will not report, such as those received
+    // with the hello reply, are processed without waiting, see
+    // Connection::has_pending_incoming.
+    const bool has_pending_incoming =
+        _client_socket->is_initialized() && _client_connection->has_pending_incoming();
+    auto err = _poller->poll(has_pending_incoming ? 0 : io_thread_poll_timeout_ms);
+    ++_stats.poll_calls;
+    if (is_error(err)) {
+        return err;
+    }
+
+    err = update_listen_socket();
+    if (is_error(err)) {
+        return err;
+    }
+
+    const bool was_ready = _client_socket->is_initialized() &&
+                           _client_connection->status() == Connection::Status::ready;
+
+    // Messages queued for a client that is gone are dropped.
+    err = forward_io_commands(was_ready);
+    if (is_error(err)) {
+        close_client_connection();
+        return err;
+    }
+
+    if (!_client_socket->is_initialized()) {
+        return ONE_ERROR_NONE;
+    }
+
+    err = update_client_connection(true);
     if (is_error(err)) {
         return err;
     }
 
     const bool is_ready = (_client_connection->status() == Connection::Status::ready);
     if (is_ready && !was_ready) {
-        // Schedule a send when connection is established to ensure newly
-        // connected client has the correct state.
-        _game_state_was_set = true;
-        _should_send_status = true;
+        _is_ready_event_pending = true;
+    }
+
+    if (_is_ready_event_pending) {
+        Message *event = _io_events->reserve();
+        if (event != nullptr) {
+            event->init(Opcode::hello, Payload());
+            _io_events->commit();
+            _is_ready_event_pending = false;
+            _has_forwarded_events = true;
+        }
+    }
+
+    return ONE_ERROR_NONE;
+}
+
+OneError Server::forward_incoming_message(const Message &message) {
+    Message *event = _io_events->reserve();
+    assert(event != nullptr);
+
+    // Copying the message only copies its received data, which is then parsed
+    // here rather than on the game thread, into memory owned by the event.
+    *event = message;
+    const uint64_t decode_start = stats::now_nanoseconds();
+    event->decode();
+    _stats.decode_nanoseconds += stats::now_nanoseconds() - decode_start;
+    ONE_ARCUS_TRACE(_tracer, payload_parse, *event);
+    _io_events->commit();
+    _has_forwarded_events = true;
+    return ONE_ERROR_NONE;
+}
+
+OneError Server::forward_io_commands(bool is_ready) {
+    while (true) {
+        Message *command = _io_commands->peek();
+        if (command == nullptr) {
+            break;
+        }
+
+        if (is_ready) {
+            auto err = _client_connection->add_outgoing(std::move(*command));
+            // Stays queued until the connection has room for it.
+            if (err == ONE_ERROR_CONNECTION_OUTGOING_QUEUE_INSUFFICIENT_SPACE) {
+                break;
+            }
+            if (is_error(err)) {
+                return err;
+            }
+        }
+
+        command->reset();
+        _io_commands->pop();
     }
 
     return ONE_ERROR_NONE;
 }
 
+OneError Server::dispatch_io_events() {
+    OneError result = ONE_ERROR_NONE;
+    while (true) {
+        Message *event = _io_events->peek();
+        if (event == nullptr) {
+            break;
+        }
+
+        if (event->code() == Opcode::hello) {
+            // Schedule a send when connection is established to ensure newly
+            // connected client has the correct state.
+            _last_sent_game_state = GameStateDigest();
+            _game_state_was_set = true;
+            _should_send_status = true;
+        } else {
+            // The error of an invalid message is reported after processing the
+            // others.
+            auto err = dispatch_incoming_message(*event);
+            if (is_error(err) && !is_error(result)) {
+                result = err;
+            }
+        }
+
+        event->reset();
+        _dispatch_stats.count_release(
+            event->release_data(messages::retained_data_capacity()));
+        _io_events->pop();
+    }
+
+    return result;
+}
+
+OneError Server::update_from_io_thread() {
+    auto err = dispatch_io_events();
+    if (is_error(err)) {
+        return err;
+    }
+
+    if (_io_status == Status::ready) {
+        err = send_pending_state();
+        // Sent on a later update once the I/O thread has caught up.
+        if (is_error(err) && err != ONE_ERROR_CONNECTION_OUTGOING_QUEUE_INSUFFICIENT_SPACE) {
+            return err;
+        }
+    }
+
+    return _io_error.exchange(ONE_ERROR_NONE);
+}
+
 OneError Server::set_live_state(int players, int max_players, const char *name,
                                 const char *map, const char *mode, const char *version,
                                 Object *additional_data) {
-    const std::lock_guard<std::mutex> lock(_server);
+    const std::lock_guard<std::mutex> lock(_live_state_writer);
+
+    // The setter takes the whole state, so the strings are compared with the
+    // last written ones and get a new version when they differ. The
+    // additional data is not read, its version tells whether it changed.
+    auto write_string = [this](const char *value, String &last_written,
+                               uint64_t &string_version) {
+        if (std::strcmp(value, last_written.c_str()) == 0) return;
+        last_written = value;
+        string_version = ++_last_string_version;
+    };
 
-    if (additional_data == nullptr) {
-        _additional_data = nullptr;
-    } else {
-        (*_additional_data) = *additional_data;
+    GameStateDigest digest = _last_written_game_state;
+    digest.players = players;
+    digest.max_players = max_players;
+    write_string(name, _last_written_name, digest.name);
+    write_string(map, _last_written_map, digest.map);
+    write_string(mode, _last_written_mode, digest.mode);
+    write_string(version, _last_written_version, digest.version);
+    digest.has_additional_data = (additional_data != nullptr);
+    digest.additional_data = (additional_data != nullptr) ? additional_data->version() : 0;
+
+    // Nothing to publish, the state is the same as last written.
+    if (digest.changed_fields(_last_written_game_state) == 0) {
+        return ONE_ERROR_NONE;
     }
 
-    _game_state.players = players;
-    _game_state.max_players = max_players;
-    _game_state.name = name;
-    _game_state.map = map;
-    _game_state.mode = mode;
-    _game_state.version = version;
-    _game_state.additional_data = _additional_data;
-    _game_state_was_set = true;
+    // The back buffer holds an older state, every field that differs from it
+    // is overwritten. The buffers keep their string and object capacity
+    // across updates.
+    GameState &state = _live_state.back();
+    const unsigned stale = digest.changed_fields(state.digest);
+    state.players = players;
+    state.max_players = max_players;
+    if (stale & live_state_name) state.name = name;
+    if (stale & live_state_map) state.map = map;
+    if (stale & live_state_mode) state.mode = mode;
+    if (stale & live_state_version) state.version = version;
+    state.has_additional_data = (additional_data != nullptr);
+    if (stale & live_state_additional_data) {
+        if (additional_data != nullptr) {
+            state.additional_data = *additional_data;
+        } else {
+            state.additional_data.clear();
+        }
+    }
+    state.digest = digest;
 
+    _live_state.publish();
+    _last_written_game_state = digest;
+    wake_waiter();
     return ONE_ERROR_NONE;
 }
 
@@ -572,6 +1316,7 @@ OneError Server::set_application_instance_status(ApplicationInstanceStatus statu
 
     _status = status;
     _should_send_status = true;
+    wake_waiter();
 
     return ONE_ERROR_NONE;
 }
@@ -590,17 +1335,19 @@ OneError Server::set_soft_stop_callback(std::function<void(void *, int)> callbac
 }
 
 OneError Server::send_live_state() {
+    GameState &state = _live_state.front();
+    Object *additional_data = state.has_additional_data ? &state.additional_data : nullptr;
+
     Message message;
     auto err = messages::prepare_live_state(
-        _game_state.players, _game_state.max_players, _game_state.name.c_str(),
-        _game_state.map.c_str(), _game_state.mode.c_str(), _game_state.version.c_str(),
-        _game_state.additional_data, message);
+        state.players, state.max_players, state.name.c_str(), state.map.c_str(),
+        state.mode.c_str(), state.version.c_str(), additional_data, message);
 
     if (is_error(err)) {
         return err;
     }
 
-    err = process_outgoing_message(message);
+    err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -609,6 +1356,8 @@ OneError Server::send_live_state() {
 }
 
 OneError Server::send_reverse_metadata(Array *data) {
+    const std::lock_guard<std::mutex> lock(_server);
+
     if (data == nullptr) {
         return ONE_ERROR_VALIDATION_DATA_IS_NULLPTR;
     }
@@ -620,11 +1369,13 @@ OneError Server::send_reverse_metadata(Array *data) {
         return err;
     }
 
-    err = process_outgoing_message(message);
+    err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
 
+    // Queued in the connection, which only sends it on update.
+    wake_waiter();
     return ONE_ERROR_NONE;
 }
 
@@ -635,7 +1386,7 @@ OneError Server::send_application_instance_status() {
         return err;
     }
 
-    err = process_outgoing_message(message);
+    err = process_outgoing_message(std::move(message));
     if (is_error(err)) {
         return err;
     }
@@ -0,0 +1,110 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <one/arcus/allocator.h>
+#include <one/arcus/error.h>
+
+namespace i3d {
+namespace one {
+
+class Poller;
+class Server;
+
+// A ServerGroup hosts many Arcus Servers in a single process, each with its own
+// listen port, callbacks and properties, and updates them all from a single
+// readiness loop. The servers share the group's poller and compression
+// scratch space.
+//
+// An update of the group polls all the sockets with a single system call, and
+// only updates the servers with a ready socket or with properties to send, so
+// that its cost follows the number of active connections rather than the
+// number of servers. All servers are also updated periodically, for their
+// listen retries and connection timers.
+//
+// The servers are owned by the caller. A server must be removed from the group,
+// or shut down, before it is destroyed. Destroying a server also removes it.
+// Property setters of a server may be called from any thread, but not
+// concurrently with its removal. The callbacks of a server may remove, shut
+// down or destroy the other servers of the group, but not their own server.
+class ServerGroup final {
+public:
+    ServerGroup();
+    ServerGroup(const ServerGroup &) = delete;
+    ServerGroup &operator=(const ServerGroup &) = delete;
+    ~ServerGroup();
+
+    OneError init();
+
+    // Shuts down and removes all the servers.
+    OneError shutdown();
+
+    // Inits the given uninitialized server to listen on the given port, and
+    // adds it to the group. As with Server::init, a failure to bind the port is
+    // retried during updates, and the server is added.
+    OneError add(Server &server, unsigned int listen_port);
+
+    // Shuts down the server and removes it from the group. Waits for a
+    // concurrent update of the server to return.
+    OneError remove(Server &server);
+
+    size_t size() const;
+
+    // Updates the servers with a ready socket, or with properties to send, as
+    // Server::update would. Every server is updated, and the first error of a
+    // server is returned.
+    OneError update();
+
+    // Blocks until update has work to do, or for at most timeout_ms
+    // milliseconds, see Server::wait. The timeout is also capped to the next
+    // periodic update of all servers.
+    OneError wait(int timeout_ms);
+
+    // Ends a concurrent or the next wait. Thread-safe.
+    void wake();
+
+    // Sets descriptor to a file descriptor that is readable whenever wait
+    // would return, see Server::descriptor.
+    OneError descriptor(int &descriptor) const;
+
+private:
+    friend class Server;
+
+    // Schedules the server for the next update. Thread-safe.
+    void schedule(Server &server);
+
+    using Servers = std::vector<Server *, StandardAllocator<Server *>>;
+
+    mutable std::mutex _group;
+    // Serializes the updates, taken before the group lock.
+    std::mutex _update;
+
+    // Destroyed by shutdown, with both the group and the schedule locks held.
+    Poller *_poller;
+    // Compression scratch space shared by the connections, which the group
+    // updates one at a time.
+    char *_compression_buffer;
+    Servers _servers;
+
+    // Servers with properties set since their last update.
+    std::mutex _schedule;
+    Servers _scheduled;
+
+    // The servers being updated, collected with the group lock held and then
+    // updated without it, so that their callbacks may remove servers. Removed
+    // servers are replaced by null. The server being updated is only shut down
+    // by a remove once its update returns.
+    Servers _updating;
+    Server *_updating_server;
+    std::condition_variable _updated;
+
+    size_t _update_count;
+    std::chrono::steady_clock::time_point _last_timers_update;
+};
+
+}  // namespace one
+}  // namespace i3d
@@ -10,8 +10,11 @@ namespace i3d {
 namespace one {
 
 // All std dynamic types in the one namespace must use the following types.
-typedef std::basic_string<char, std::char_traits<char>, StandardAllocator<char>> String;
-typedef std::basic_ostringstream<char, std::char_traits<char>, StandardAllocator<char>>
+typedef std::basic_string<char, std::char_traits<char>,
+                          StandardAllocator<char, allocator::Tag::string>>
+    String;
+typedef std::basic_ostringstream<char, std::char_traits<char>,
+                                 StandardAllocator<char, allocator::Tag::string>>
     OStringStream;
 
 std::string to_std_string(const String &);
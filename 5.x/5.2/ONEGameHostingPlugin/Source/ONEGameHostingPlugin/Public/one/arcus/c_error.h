@@ -24,6 +24,7 @@ typedef enum OneError {
     ONE_ERROR_ARRAY_WRONG_TYPE_IS_EXPECTING_OBJECT = 105,
     ONE_ERROR_ARRAY_WRONG_TYPE_IS_EXPECTING_STRING = 106,
     ONE_ERROR_CLIENT_NOT_INITIALIZED = 200,
+    ONE_ERROR_CLIENT_ALLOCATION_FAILED = 201,
     ONE_ERROR_CODEC_HEADER_LENGTH_TOO_SMALL = 300,
     ONE_ERROR_CODEC_HEADER_LENGTH_TOO_BIG = 301,
     ONE_ERROR_CODEC_DATA_LENGTH_TOO_SMALL_FOR_HEADER = 302,
@@ -32,6 +33,7 @@ typedef enum OneError {
     ONE_ERROR_CODEC_INVALID_MESSAGE_PAYLOAD_SIZE_TOO_BIG = 305,
     ONE_ERROR_CODEC_INVALID_HEADER = 306,
     ONE_ERROR_CODEC_TRYING_TO_ENCODE_UNSUPPORTED_OPCODE = 307,
+    ONE_ERROR_CODEC_INVALID_COMPRESSED_PAYLOAD = 308,
     ONE_ERROR_CONNECTION_UNINITIALIZED = 400,
     ONE_ERROR_CONNECTION_HANDSHAKE_TIMEOUT = 401,
     ONE_ERROR_CONNECTION_HEALTH_TIMEOUT = 402,
@@ -58,6 +60,7 @@ typedef enum OneError {
     ONE_ERROR_CONNECTION_UNKNOWN_STATUS = 423,
     ONE_ERROR_CONNECTION_UPDATE_AFTER_ERROR = 424,
     ONE_ERROR_CONNECTION_UPDATE_READY_FAIL = 425,
+    ONE_ERROR_CONNECTION_CLOSED_BY_PEER = 426,
     ONE_ERROR_MESSAGE_ALLOCATION_FAILED = 500,
     ONE_ERROR_MESSAGE_CALLBACK_IS_NULLPTR = 501,
     ONE_ERROR_MESSAGE_IS_NULLPTR = 502,
@@ -102,6 +105,10 @@ typedef enum OneError {
     ONE_ERROR_SERVER_SOCKET_NOT_INITIALIZED = 809,
     ONE_ERROR_SERVER_SOCKET_IS_NULLPTR = 810,
     ONE_ERROR_SERVER_OBJECT_ALLOCATION_FAILED = 811,
+    ONE_ERROR_SERVER_DESCRIPTOR_UNAVAILABLE = 812,
+    ONE_ERROR_SERVER_IS_IN_GROUP = 813,
+    ONE_ERROR_SERVER_NOT_IN_GROUP = 814,
+    ONE_ERROR_SERVER_TRACING_DISABLED = 815,
     ONE_ERROR_SOCKET_ACCEPT_NON_BLOCKING_FAILED = 900,
     ONE_ERROR_SOCKET_ACCEPT_UNINITIALIZED = 901,
     ONE_ERROR_SOCKET_ADDRESS_FAILED = 902,
@@ -121,6 +128,13 @@ typedef enum OneError {
     ONE_ERROR_SOCKET_SOCKET_OPTIONS_FAILED = 916,
     ONE_ERROR_SOCKET_SYSTEM_CLEANUP_FAIL = 917,
     ONE_ERROR_SOCKET_SYSTEM_INIT_FAIL = 918,
+    ONE_ERROR_SOCKET_POLLER_ADD_FAILED = 919,
+    ONE_ERROR_SOCKET_POLLER_INIT_FAILED = 920,
+    ONE_ERROR_SOCKET_POLLER_MODIFY_FAILED = 921,
+    ONE_ERROR_SOCKET_POLLER_REMOVE_FAILED = 922,
+    ONE_ERROR_SOCKET_POLLER_UNINITIALIZED = 923,
+    ONE_ERROR_SOCKET_POLLER_WAIT_FAILED = 924,
+    ONE_ERROR_SOCKET_CLOSED_BY_PEER = 925,
     ONE_ERROR_VALIDATION_ARRAY_IS_NULLPTR = 1000,
     ONE_ERROR_VALIDATION_CALLBACK_IS_NULLPTR = 1001,
     ONE_ERROR_VALIDATION_CAPACITY_IS_NULLPTR = 1002,
@@ -143,7 +157,13 @@ typedef enum OneError {
     ONE_ERROR_VALIDATION_SIZE_IS_NULLPTR = 1019,
     ONE_ERROR_VALIDATION_VAL_IS_NULLPTR = 1020,
     ONE_ERROR_VALIDATION_VAL_SIZE_IS_TOO_SMALL = 1021,
-    ONE_ERROR_VALIDATION_VERSION_IS_NULLPTR = 1022
+    ONE_ERROR_VALIDATION_VERSION_IS_NULLPTR = 1022,
+    ONE_ERROR_VALIDATION_SERVER_GROUP_IS_NULLPTR = 1023,
+    ONE_ERROR_VALIDATION_ALLOCATION_TAG_IS_INVALID = 1024,
+    ONE_ERROR_VALIDATION_MESSAGE_TYPE_NOT_COALESCABLE = 1025,
+    ONE_ERROR_VALIDATION_INCOMING_OVERFLOW_IS_INVALID = 1026,
+    ONE_ERROR_VALIDATION_MEMORY_SIZES_ARE_INVALID = 1027,
+    ONE_ERROR_VALIDATION_MEMORY_PROFILE_IS_INVALID = 1028
 } OneError;
 
 ONE_EXPORT bool one_is_error(OneError err);
@@ -14,22 +14,36 @@ Array::Array(const Array &other) {
 }
 
 Array &Array::operator=(const Array &other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    _doc.SetArray();
+    _doc.GetAllocator().release();
     _doc.CopyFrom(other.get(), _doc.GetAllocator());
     return *this;
 }
 
-OneError Array::set(const rapidjson::Value &array) {
+OneError Array::set(const JsonValue &array) {
     if (!array.IsArray()) {
         return ONE_ERROR_ARRAY_WRONG_TYPE_IS_EXPECTING_ARRAY;
     }
 
-    _doc.Clear();
-    _doc.CopyFrom(array, _doc.GetAllocator());
+    _doc.SetArray();
+    _doc.GetAllocator().release();
+    // Const strings are copied since they may refer to the data of an in
+    // place parse, e.g. from a received message payload.
+    _doc.CopyFrom(array, _doc.GetAllocator(), true);
     return ONE_ERROR_NONE;
 }
 
+// The values are dropped before the pool they are allocated from is released,
+// then the capacity is reserved again.
 void Array::clear() {
-    _doc.Clear();
+    const auto capacity = _doc.Capacity();
+    _doc.SetArray();
+    _doc.GetAllocator().release();
+    _doc.Reserve(capacity, _doc.GetAllocator());
 }
 
 void Array::reserve(size_t size) {
@@ -57,17 +71,17 @@ void Array::push_back_int(int val) {
 }
 
 void Array::push_back_string(const String &val) {
-    _doc.PushBack(rapidjson::Value(val.c_str(), _doc.GetAllocator()).Move(),
+    _doc.PushBack(JsonValue(val.c_str(), _doc.GetAllocator()).Move(),
                   _doc.GetAllocator());
 }
 
 void Array::push_back_array(const Array &val) {
-    _doc.PushBack(rapidjson::Value(val.get(), _doc.GetAllocator()).Move(),
+    _doc.PushBack(JsonValue(val.get(), _doc.GetAllocator()).Move(),
                   _doc.GetAllocator());
 }
 
 void Array::push_back_object(const Object &val) {
-    _doc.PushBack(rapidjson::Value(val.get(), _doc.GetAllocator()).Move(),
+    _doc.PushBack(JsonValue(val.get(), _doc.GetAllocator()).Move(),
                   _doc.GetAllocator());
 }
 
@@ -0,0 +1,336 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include <one/arcus/internal/poller.h>
+
+#include <assert.h>
+#include <chrono>
+#include <thread>
+
+#ifdef ONE_WINDOWS
+#else
+    #include <errno.h>
+    #include <stdint.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+#endif
+
+namespace i3d {
+namespace one {
+
+#if defined(ONE_WINDOWS)
+Poller::Poller()
+    : _entries(), _index(), _ready(), _poll_fds(), _is_initialized(false) {}
+#else
+// See: https://en.cppreference.com/w/cpp/language/value_initialization
+// C++11 Value initialization
+Poller::Poller() : _entries(), _index(), _ready(), _epoll(-1), _wake(-1), _events{} {}
+#endif
+
+Poller::~Poller() {
+    shutdown();
+}
+
+OneError Poller::init() {
+    if (is_initialized()) return ONE_ERROR_NONE;
+
+#if defined(ONE_WINDOWS)
+    _is_initialized = true;
+#else
+    _epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (_epoll < 0) {
+        _epoll = -1;
+        return ONE_ERROR_SOCKET_POLLER_INIT_FAILED;
+    }
+
+    _wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = _wake;
+    if (_wake < 0 || ::epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake, &event) < 0) {
+        shutdown();
+        return ONE_ERROR_SOCKET_POLLER_INIT_FAILED;
+    }
+#endif
+    return ONE_ERROR_NONE;
+}
+
+void Poller::shutdown() {
+    _entries.clear();
+    _index.clear();
+    _ready.clear();
+#if defined(ONE_WINDOWS)
+    _poll_fds.clear();
+    _is_initialized = false;
+#else
+    if (_wake >= 0) {
+        ::close(_wake);
+        _wake = -1;
+    }
+    if (_epoll >= 0) {
+        ::close(_epoll);
+        _epoll = -1;
+    }
+#endif
+}
+
+bool Poller::is_initialized() const {
+#if defined(ONE_WINDOWS)
+    return _is_initialized;
+#else
+    return _epoll >= 0;
+#endif
+}
+
+OneError Poller::add(const Socket &socket, void *context) {
+    if (!is_initialized()) return ONE_ERROR_SOCKET_POLLER_UNINITIALIZED;
+    if (!socket.is_initialized()) return ONE_ERROR_SOCKET_POLLER_ADD_FAILED;
+    if (find(socket._socket) != nullptr) return ONE_ERROR_SOCKET_POLLER_ADD_FAILED;
+
+#if !defined(ONE_WINDOWS)
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = socket._socket;
+    if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, socket._socket, &event) < 0) {
+        return ONE_ERROR_SOCKET_POLLER_ADD_FAILED;
+    }
+#endif
+
+    _index[socket._socket] = _entries.size();
+    _entries.push_back({socket._socket, context, true, false, false, false});
+    return ONE_ERROR_NONE;
+}
+
+OneError Poller::remove(const Socket &socket) {
+    if (!is_initialized()) return ONE_ERROR_SOCKET_POLLER_UNINITIALIZED;
+
+    auto it = _index.find(socket._socket);
+    if (it == _index.end()) return ONE_ERROR_SOCKET_POLLER_REMOVE_FAILED;
+
+    // The last entry takes the place of the removed one.
+    const size_t position = it->second;
+    _index.erase(it);
+    if (position + 1 != _entries.size()) {
+        _entries[position] = _entries.back();
+        _index[_entries[position].socket] = position;
+    }
+    _entries.pop_back();
+
+#if !defined(ONE_WINDOWS)
+    // The event argument is ignored, but must be non-null on kernels older
+    // than 2.6.9.
+    epoll_event event{};
+    if (::epoll_ctl(_epoll, EPOLL_CTL_DEL, socket._socket, &event) < 0) {
+        return ONE_ERROR_SOCKET_POLLER_REMOVE_FAILED;
+    }
+#endif
+    return ONE_ERROR_NONE;
+}
+
+OneError Poller::set_read_interest(const Socket &socket, bool enable) {
+    if (!is_initialized()) return ONE_ERROR_SOCKET_POLLER_UNINITIALIZED;
+
+    auto entry = find(socket._socket);
+    if (entry == nullptr) return ONE_ERROR_SOCKET_POLLER_MODIFY_FAILED;
+    if (entry->read_interest == enable) return ONE_ERROR_NONE;
+
+    auto err = modify(*entry, enable, entry->write_interest);
+    if (is_error(err)) return err;
+
+    entry->read_interest = enable;
+    if (!enable) {
+        entry->readable = false;
+    }
+    return ONE_ERROR_NONE;
+}
+
+OneError Poller::set_write_interest(const Socket &socket, bool enable) {
+    if (!is_initialized()) return ONE_ERROR_SOCKET_POLLER_UNINITIALIZED;
+
+    auto entry = find(socket._socket);
+    if (entry == nullptr) return ONE_ERROR_SOCKET_POLLER_MODIFY_FAILED;
+    if (entry->write_interest == enable) return ONE_ERROR_NONE;
+
+    auto err = modify(*entry, entry->read_interest, enable);
+    if (is_error(err)) return err;
+
+    entry->write_interest = enable;
+    // Until the next poll, assume the socket is not writable since enabling the
+    // interest means a send was just unable to complete.
+    entry->writable = false;
+    return ONE_ERROR_NONE;
+}
+
+OneError Poller::modify(const Entry &entry, bool read, bool write) {
+#if defined(ONE_WINDOWS)
+    // The interests are passed to each poll.
+    (void)entry;
+    (void)read;
+    (void)write;
+#else
+    epoll_event event{};
+    if (read) event.events |= EPOLLIN;
+    if (write) event.events |= EPOLLOUT;
+    event.data.fd = entry.socket;
+    if (::epoll_ctl(_epoll, EPOLL_CTL_MOD, entry.socket, &event) < 0) {
+        return ONE_ERROR_SOCKET_POLLER_MODIFY_FAILED;
+    }
+#endif
+    return ONE_ERROR_NONE;
+}
+
+OneError Poller::poll(int timeout_ms) {
+    if (!is_initialized()) return ONE_ERROR_SOCKET_POLLER_UNINITIALIZED;
+
+    // Only the sockets found ready by the previous poll have readiness to
+    // clear.
+    for (auto socket : _ready) {
+        auto entry = find(socket);
+        if (entry == nullptr) continue;
+        entry->readable = false;
+        entry->writable = false;
+    }
+    _ready.clear();
+
+    if (_entries.empty()) {
+#if !defined(ONE_WINDOWS)
+        // Nothing else can be ready, but a pending wake must not keep the
+        // descriptor readable.
+        drain_wake();
+#endif
+        return ONE_ERROR_NONE;
+    }
+
+#if defined(ONE_WINDOWS)
+    _poll_fds.resize(_entries.size());
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        auto &fd = _poll_fds[i];
+        fd.fd = _entries[i].socket;
+        fd.events = (_entries[i].read_interest ? POLLRDNORM : 0) |
+                    (_entries[i].write_interest ? POLLWRNORM : 0);
+        fd.revents = 0;
+    }
+
+    const int result =
+        ::WSAPoll(_poll_fds.data(), static_cast<ULONG>(_poll_fds.size()), timeout_ms);
+    if (result < 0) return ONE_ERROR_SOCKET_POLLER_WAIT_FAILED;
+
+    for (size_t i = 0; i < _entries.size() && result > 0; ++i) {
+        const auto revents = _poll_fds[i].revents;
+        const bool failed = (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+        _entries[i].readable = failed || (revents & POLLRDNORM) != 0;
+        _entries[i].writable = failed || (revents & POLLWRNORM) != 0;
+        if (_entries[i].readable || _entries[i].writable) {
+            _ready.push_back(_entries[i].socket);
+        }
+    }
+#else
+    const int count = ::epoll_wait(_epoll, _events.data(),
+                                   static_cast<int>(_events.size()), timeout_ms);
+    if (count < 0) {
+        // Interrupted by a signal, treat as a timeout.
+        if (errno == EINTR) return ONE_ERROR_NONE;
+        return ONE_ERROR_SOCKET_POLLER_WAIT_FAILED;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const auto &event = _events[i];
+        if (event.data.fd == _wake) {
+            drain_wake();
+            continue;
+        }
+
+        auto entry = find(event.data.fd);
+        if (entry == nullptr) continue;
+
+        const bool failed = (event.events & (EPOLLERR | EPOLLHUP)) != 0;
+        entry->readable = failed || (event.events & EPOLLIN) != 0;
+        entry->writable = failed || (event.events & EPOLLOUT) != 0;
+        _ready.push_back(entry->socket);
+    }
+#endif
+
+    return ONE_ERROR_NONE;
+}
+
+OneError Poller::wait(int timeout_ms) {
+    if (!is_initialized()) return ONE_ERROR_SOCKET_POLLER_UNINITIALIZED;
+
+#if defined(ONE_WINDOWS)
+    if (_entries.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        return ONE_ERROR_NONE;
+    }
+    return poll(timeout_ms);
+#else
+    // Level-triggered readiness is reported again by the following poll, so
+    // the events are not kept. The wake is always registered, so this blocks
+    // even without registered sockets.
+    std::array<epoll_event, max_events> events;
+    const int count =
+        ::epoll_wait(_epoll, events.data(), static_cast<int>(events.size()), timeout_ms);
+    if (count < 0) {
+        if (errno == EINTR) return ONE_ERROR_NONE;
+        return ONE_ERROR_SOCKET_POLLER_WAIT_FAILED;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (events[i].data.fd == _wake) drain_wake();
+    }
+    return ONE_ERROR_NONE;
+#endif
+}
+
+void Poller::wake() {
+#if !defined(ONE_WINDOWS)
+    if (_wake < 0) return;
+    const uint64_t value = 1;
+    // Fails only if the counter would overflow, in which case a wake is
+    // already pending.
+    const auto result = ::write(_wake, &value, sizeof(value));
+    (void)result;
+#endif
+}
+
+int Poller::descriptor() const {
+#if defined(ONE_WINDOWS)
+    return -1;
+#else
+    return _epoll;
+#endif
+}
+
+#if !defined(ONE_WINDOWS)
+void Poller::drain_wake() {
+    uint64_t value = 0;
+    const auto result = ::read(_wake, &value, sizeof(value));
+    (void)result;
+}
+#endif
+
+bool Poller::is_readable(const Socket &socket) const {
+    const auto entry = find(socket._socket);
+    return entry != nullptr && entry->readable;
+}
+
+bool Poller::is_writable(const Socket &socket) const {
+    const auto entry = find(socket._socket);
+    return entry != nullptr && entry->writable;
+}
+
+void *Poller::ready_context(size_t index) const {
+    assert(index < _ready.size());
+    const auto entry = find(_ready[index]);
+    return entry != nullptr ? entry->context : nullptr;
+}
+
+Poller::Entry *Poller::find(SOCKET socket) {
+    auto it = _index.find(socket);
+    return it != _index.end() ? &_entries[it->second] : nullptr;
+}
+
+const Poller::Entry *Poller::find(SOCKET socket) const {
+    auto it = _index.find(socket);
+    return it != _index.end() ? &_entries[it->second] : nullptr;
+}
+
+}  // namespace one
+}  // namespace i3d
@@ -0,0 +1,103 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+#include <stddef.h>
+
+#include <one/arcus/internal/rapidjson/document.h>
+#include <one/arcus/internal/rapidjson/stringbuffer.h>
+#include <one/arcus/internal/rapidjson/writer.h>
+
+namespace rapidjson = RAPIDJSON_NAMESPACE;
+
+namespace i3d {
+namespace one {
+
+// rapidjson base allocator over the SDK allocator, in place of rapidjson's
+// CrtAllocator, for the arena chunks and the writer and string buffer stacks.
+class JsonBaseAllocator final {
+public:
+    static const bool kNeedFree = true;
+
+    void *Malloc(size_t size);
+    void *Realloc(void *original, size_t original_size, size_t new_size);
+    static void Free(void *p);
+};
+
+// Memory pool that JSON documents can be allocated from. It is cleared as a
+// whole, without freeing individual values. The memory beyond its initial
+// buffer is allocated in chunks of json::arena_chunk_size() bytes.
+using JsonArena = rapidjson::MemoryPoolAllocator<JsonBaseAllocator>;
+
+// rapidjson allocator used by all the JSON documents of the SDK. It allocates
+// from an arena when given one, so that parsing into an arena backed document
+// makes no heap allocations, and otherwise from a pool of its own, created on
+// first use, so that building or parsing a document makes one allocation per
+// chunk instead of one per value.
+//
+// Like rapidjson's default allocator, it does not free individual values. The
+// pool keeps its first chunk of json::arena_chunk_size() bytes, the others are
+// freed when it is released, which the documents do when their whole content
+// is replaced or cleared.
+class JsonAllocator final {
+public:
+    static const bool kNeedFree = false;
+
+    JsonAllocator() : _arena(nullptr), _pool(nullptr), _pool_buffer(nullptr) {}
+    explicit JsonAllocator(JsonArena *arena)
+        : _arena(arena), _pool(nullptr), _pool_buffer(nullptr) {}
+    JsonAllocator(const JsonAllocator &) = delete;
+    JsonAllocator &operator=(const JsonAllocator &) = delete;
+    ~JsonAllocator();
+
+    void *Malloc(size_t size);
+    void *Realloc(void *original, size_t original_size, size_t new_size);
+    static void Free(void *) {}
+
+    // The arena allocated from, or null for the own pool.
+    JsonArena *arena() const {
+        return _arena;
+    }
+
+    // Releases the values allocated from the own pool, which must no longer be
+    // referred to. The given arena, if any, is left to its owner to clear.
+    void release();
+
+    // Exchanges the own pools, along with the values allocated from them, e.g.
+    // when swapping the content of two documents.
+    void swap(JsonAllocator &other);
+
+private:
+    JsonArena *pool();
+
+    JsonArena *_arena;
+    JsonArena *_pool;
+    char *_pool_buffer;
+};
+
+using JsonValue = rapidjson::GenericValue<rapidjson::UTF8<>, JsonAllocator>;
+using JsonDocument =
+    rapidjson::GenericDocument<rapidjson::UTF8<>, JsonAllocator, JsonAllocator>;
+
+using JsonStringBuffer = rapidjson::GenericStringBuffer<rapidjson::UTF8<>, JsonBaseAllocator>;
+template <typename OutputStream>
+using JsonWriter =
+    rapidjson::Writer<OutputStream, rapidjson::UTF8<>, rapidjson::UTF8<>, JsonBaseAllocator>;
+
+namespace json {
+
+// Initial capacity of a document parse stack.
+constexpr size_t stack_capacity() {
+    return 1024;
+}
+
+// Size of the chunks allocated by arenas beyond their initial buffer, 4 KB by
+// default instead of rapidjson's 64 KB, which is oversized for Arcus
+// payloads. A larger value allocated at once gets a chunk of its own. Must be
+// set at init time, before any arena is created. Zero restores the default.
+void set_arena_chunk_size(size_t size);
+size_t arena_chunk_size();
+
+}  // namespace json
+
+}  // namespace one
+}  // namespace i3d
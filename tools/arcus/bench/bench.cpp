@@ -0,0 +1,521 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+//
+// Benchmark of the Arcus core, printing its results as a single JSON object on
+// the standard output, so that runs of different SDK drops can be compared.
+//
+// Usage: arcus_bench [--iterations N] [--port PORT]
+//
+// Times are in nanoseconds per operation, except the loopback latencies, which
+// are in microseconds.
+
+#include <one/arcus/array.h>
+#include <one/arcus/client.h>
+#include <one/arcus/internal/accumulator.h>
+#include <one/arcus/internal/codec.h>
+#include <one/arcus/internal/ring.h>
+#include <one/arcus/internal/version.h>
+#include <one/arcus/message.h>
+#include <one/arcus/object.h>
+#include <one/arcus/server.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace i3d::one;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double nanoseconds_since(Clock::time_point start, size_t count) {
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    return static_cast<double>(elapsed.count()) / static_cast<double>(count);
+}
+
+void check(OneError err, const char *what) {
+    if (is_error(err)) {
+        std::fprintf(stderr, "%s failed: %s\n", what, error_text(err));
+        std::exit(1);
+    }
+}
+
+// Separates the members of the JSON output.
+class JsonList {
+public:
+    void next() {
+        if (!_is_first) std::printf(",");
+        _is_first = false;
+    }
+
+private:
+    bool _is_first = true;
+};
+
+Object key_value(const char *key, const char *value) {
+    Object object;
+    object.set_val_string("key", key);
+    object.set_val_string("value", value);
+    return object;
+}
+
+// A message of each opcode sent by the server or the agent, with a payload of
+// a typical size.
+struct Sample {
+    const char *name;
+    Message message;
+};
+
+std::vector<Sample> samples() {
+    Array array;
+    for (int i = 0; i < 8; ++i) {
+        const std::string key = "key_" + std::to_string(i);
+        array.push_back_object(key_value(key.c_str(), "some value of the metadata"));
+    }
+    Object information;
+    information.set_val_int("id", 1234);
+    information.set_val_string("ip", "127.0.0.1");
+    information.set_val_string("location", "eu-west");
+    information.set_val_string("name", "host name");
+
+    std::vector<Sample> result(9);
+    result[0].name = "soft_stop";
+    check(messages::prepare_soft_stop(1000, result[0].message), "prepare_soft_stop");
+    result[1].name = "allocated";
+    check(messages::prepare_allocated(array, result[1].message), "prepare_allocated");
+    result[2].name = "metadata";
+    check(messages::prepare_metadata(array, result[2].message), "prepare_metadata");
+    result[3].name = "reverse_metadata";
+    check(messages::prepare_reverse_metadata(array, result[3].message),
+          "prepare_reverse_metadata");
+    result[4].name = "live_state";
+    check(messages::prepare_live_state(12, 64, "server name", "map", "mode", "1.0.0",
+                                       nullptr, result[4].message),
+          "prepare_live_state");
+    result[5].name = "host_information";
+    check(messages::prepare_host_information(information, result[5].message),
+          "prepare_host_information");
+    result[6].name = "application_instance_information";
+    check(messages::prepare_application_instance_information(information,
+                                                             result[6].message),
+          "prepare_application_instance_information");
+    result[7].name = "application_instance_status";
+    check(messages::prepare_application_instance_status(3, result[7].message),
+          "prepare_application_instance_status");
+    result[8].name = "custom_command";
+    check(messages::prepare_custom_command(array, result[8].message),
+          "prepare_custom_command");
+    return result;
+}
+
+struct CodecResult {
+    size_t bytes;
+    double encode_ns;
+    double decode_ns;
+};
+
+// codec::message_to_data and codec::data_to_message, including the parsing of
+// the payload, of a message encoded with the given options.
+CodecResult measure_codec(const Message &message, const codec::EncodeOptions &options,
+                          size_t iterations) {
+    const size_t capacity = codec::header_size() + codec::payload_max_size();
+    std::vector<char> data(capacity);
+    CodecResult result{};
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        check(codec::message_to_data(1, message, options, data.data(), capacity,
+                                     result.bytes),
+              "message_to_data");
+    }
+    result.encode_ns = nanoseconds_since(start, iterations);
+
+    Message decoded;
+    codec::Header header{};
+    size_t read = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        check(codec::data_to_message(data.data(), result.bytes, read, header, decoded),
+              "data_to_message");
+        check(decoded.decode(), "decode");
+    }
+    result.decode_ns = nanoseconds_since(start, iterations);
+    return result;
+}
+
+const struct {
+    const char *name;
+    char capabilities;
+} encodings[] = {{"json", codec::capability::none}, {"msgpack", codec::capability::msgpack}};
+
+// Each opcode and payload encoding, uncompressed.
+void bench_codec(size_t iterations) {
+    std::printf("\"codec\":[");
+    JsonList list;
+    for (auto &sample : samples()) {
+        for (const auto &encoding : encodings) {
+            const auto options = codec::encode_options(encoding.capabilities, 0, nullptr);
+            const CodecResult result = measure_codec(sample.message, options, iterations);
+            list.next();
+            std::printf(
+                "{\"opcode\":\"%s\",\"encoding\":\"%s\",\"bytes\":%zu,"
+                "\"encode_ns\":%.1f,\"decode_ns\":%.1f}",
+                sample.name, encoding.name, result.bytes, result.encode_ns,
+                result.decode_ns);
+        }
+    }
+    std::printf("]");
+}
+
+// Large metadata and custom command payloads, shaped like those sent by the
+// agent: many entries repeating the same keys with varied values.
+std::vector<Sample> large_samples() {
+    Array metadata;
+    for (int i = 0; i < 200; ++i) {
+        const std::string key = "game_setting_" + std::to_string(i);
+        const std::string value = "value_" + std::to_string(i * 7919 % 10007);
+        metadata.push_back_object(key_value(key.c_str(), value.c_str()));
+    }
+
+    Array commands;
+    for (int i = 0; i < 100; ++i) {
+        Object command;
+        command.set_val_string("command", (i % 3 == 0) ? "kick_player" : "set_mute");
+        command.set_val_int("player_id", 100000 + i * 37);
+        const std::string reason = "requested by moderator " + std::to_string(i % 9);
+        command.set_val_string("reason", reason.c_str());
+        command.set_val_bool("notify", i % 2 == 0);
+        commands.push_back_object(command);
+    }
+
+    std::vector<Sample> result(2);
+    result[0].name = "metadata";
+    check(messages::prepare_metadata(metadata, result[0].message), "prepare_metadata");
+    result[1].name = "custom_command";
+    check(messages::prepare_custom_command(commands, result[1].message),
+          "prepare_custom_command");
+    return result;
+}
+
+// The large payloads of each encoding, uncompressed and compressed with LZ4
+// above the default threshold, to compare the CPU time spent with the bytes
+// saved.
+void bench_compression(size_t iterations) {
+    std::vector<char> buffer(codec::payload_max_size());
+    std::printf(",\"compression\":[");
+    JsonList list;
+    for (auto &sample : large_samples()) {
+        for (const auto &encoding : encodings) {
+            const auto plain = measure_codec(
+                sample.message, codec::encode_options(encoding.capabilities, 0, nullptr),
+                iterations);
+            const auto compressed = measure_codec(
+                sample.message,
+                codec::encode_options(encoding.capabilities | codec::capability::compression,
+                                      codec::compression_threshold_default(),
+                                      buffer.data()),
+                iterations);
+            list.next();
+            std::printf(
+                "{\"opcode\":\"%s\",\"encoding\":\"%s\",\"bytes\":%zu,"
+                "\"encode_ns\":%.1f,\"decode_ns\":%.1f,\"compressed_bytes\":%zu,"
+                "\"compressed_encode_ns\":%.1f,\"compressed_decode_ns\":%.1f}",
+                sample.name, encoding.name, plain.bytes, plain.encode_ns, plain.decode_ns,
+                compressed.bytes, compressed.encode_ns, compressed.decode_ns);
+        }
+    }
+    std::printf("]");
+}
+
+// Payload::from_json and Payload::to_json of a metadata payload.
+void bench_payload(size_t iterations) {
+    const String json = samples()[2].message.payload().to_json();
+
+    Payload payload;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        check(payload.from_json({json.data(), json.size()}), "from_json");
+    }
+    const double from_json_ns = nanoseconds_since(start, iterations);
+
+    size_t length = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        length += payload.to_json().size();
+    }
+    const double to_json_ns = nanoseconds_since(start, iterations);
+
+    std::printf(",\"payload\":{\"bytes\":%zu,\"from_json_ns\":%.1f,\"to_json_ns\":%.1f}",
+                length / iterations, from_json_ns, to_json_ns);
+}
+
+// Accumulator put, peek and trim of frames, and Ring push and pop of messages,
+// as done by the connection.
+void bench_buffers(size_t iterations) {
+    const size_t frame_size = 256;
+    char frame[frame_size] = {};
+    Accumulator stream(1024 * 128, 1024 * 128);
+    const size_t batch = 64;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0; j < batch; ++j) {
+            stream.put(frame, frame_size);
+        }
+        for (size_t j = 0; j < batch; ++j) {
+            void *data = nullptr;
+            stream.peek(frame_size, &data);
+            stream.trim(frame_size);
+        }
+    }
+    const double accumulator_ns = nanoseconds_since(start, iterations * batch);
+
+    Ring<Message> ring(48);
+    Message message = samples()[0].message;
+    start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0; j < 48; ++j) {
+            *ring.reserve() = message;
+            ring.commit();
+        }
+        for (size_t j = 0; j < 48; ++j) {
+            ring.pop();
+        }
+    }
+    const double ring_ns = nanoseconds_since(start, iterations * 48);
+
+    std::printf(",\"accumulator\":{\"frame_bytes\":%zu,\"put_peek_trim_ns\":%.1f}",
+                frame_size, accumulator_ns);
+    std::printf(",\"ring\":{\"push_pop_ns\":%.1f}", ring_ns);
+}
+
+// Server::set_live_state with an unchanged state, which is only compared, and
+// with a changed one, which is also copied and published. The additional data
+// is the payload of a metadata message.
+void bench_live_state(size_t iterations) {
+    Server server;
+    Object additional_data;
+    for (int i = 0; i < 8; ++i) {
+        const std::string key = "key_" + std::to_string(i);
+        additional_data.set_val_string(key.c_str(), "some value of the metadata");
+    }
+
+    auto set = [&](int players) {
+        check(server.set_live_state(players, 64, "server name", "map", "mode", "1.0.0",
+                                    &additional_data),
+              "set_live_state");
+    };
+    set(0);
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        set(0);
+    }
+    const double unchanged_ns = nanoseconds_since(start, iterations);
+
+    start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        set(static_cast<int>(i % 2) + 1);
+    }
+    const double changed_ns = nanoseconds_since(start, iterations);
+
+    std::printf(",\"live_state\":{\"set_unchanged_ns\":%.1f,\"set_changed_ns\":%.1f}",
+                unchanged_ns, changed_ns);
+}
+
+// Updates the server and client until they are connected.
+void connect_loopback(Server &server, Client &client) {
+    const auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (server.status() != Server::Status::ready ||
+           client.status() != Client::Status::ready) {
+        if (Clock::now() > deadline) {
+            std::fprintf(stderr, "loopback handshake timed out\n");
+            std::exit(1);
+        }
+        check(server.update(), "server update");
+        check(client.update(), "client update");
+    }
+}
+
+// Latencies of Server::set_live_state called from this thread while another
+// thread updates the server, which sends large reverse metadata to a Client.
+// In the locked run, set_live_state waits for a mutex that the other thread
+// holds during Server::update, as the server mutex was before the live state
+// was published through a triple buffer. The lock free run is the current
+// behavior.
+void bench_live_state_contention(size_t iterations, unsigned int port) {
+    Server server;
+    check(server.init(port), "server init");
+    Client client;
+    check(client.init("127.0.0.1", port), "client init");
+    std::atomic<size_t> received(0);
+    client.set_reverse_metadata_callback([&](void *, Array *) { ++received; }, nullptr);
+    connect_loopback(server, client);
+
+    Array array;
+    for (int i = 0; i < 64; ++i) {
+        const std::string key = "key_" + std::to_string(i);
+        array.push_back_object(key_value(key.c_str(), "some value of the metadata"));
+    }
+    Object additional_data;
+    additional_data.set_val_string("mode_detail", "capture the flag");
+
+    std::mutex update_lock;
+    std::atomic<bool> is_locked(false);
+    std::atomic<bool> is_running(true);
+    std::thread updater([&]() {
+        size_t sent = 0;
+        while (is_running) {
+            // Keeps messages in flight.
+            if (sent - received < 16) {
+                check(server.send_reverse_metadata(&array), "send_reverse_metadata");
+                ++sent;
+            }
+            if (is_locked) {
+                const std::lock_guard<std::mutex> lock(update_lock);
+                check(server.update(), "server update");
+            } else {
+                check(server.update(), "server update");
+            }
+            check(client.update(), "client update");
+        }
+    });
+
+    auto measure = [&](bool locked, double &p50_ns, double &p99_ns) {
+        is_locked = locked;
+        std::vector<double> latencies_ns;
+        latencies_ns.reserve(iterations);
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = Clock::now();
+            if (locked) {
+                const std::lock_guard<std::mutex> lock(update_lock);
+                check(server.set_live_state(static_cast<int>(i), 64, "server name", "map",
+                                            "mode", "1.0.0", &additional_data),
+                      "set_live_state");
+            } else {
+                check(server.set_live_state(static_cast<int>(i), 64, "server name", "map",
+                                            "mode", "1.0.0", &additional_data),
+                      "set_live_state");
+            }
+            latencies_ns.push_back(nanoseconds_since(start, 1));
+            // The game thread sets its state once per frame at most.
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        std::sort(latencies_ns.begin(), latencies_ns.end());
+        p50_ns = latencies_ns[latencies_ns.size() / 2];
+        p99_ns = latencies_ns[latencies_ns.size() * 99 / 100];
+    };
+
+    double locked_p50_ns = 0;
+    double locked_p99_ns = 0;
+    double lock_free_p50_ns = 0;
+    double lock_free_p99_ns = 0;
+    measure(true, locked_p50_ns, locked_p99_ns);
+    measure(false, lock_free_p50_ns, lock_free_p99_ns);
+    is_running = false;
+    updater.join();
+
+    client.shutdown();
+    server.shutdown();
+
+    std::printf(
+        ",\"live_state_contention\":{\"messages_received\":%zu,"
+        "\"locked\":{\"p50_ns\":%.1f,\"p99_ns\":%.1f},"
+        "\"lock_free\":{\"p50_ns\":%.1f,\"p99_ns\":%.1f}}",
+        received.load(), locked_p50_ns, locked_p99_ns, lock_free_p50_ns, lock_free_p99_ns);
+}
+
+// Messages sent by a Server to the in-repo Client over loopback, both updated
+// from this thread: the latency of single messages, and the rate of bursts.
+void bench_loopback(size_t iterations, unsigned int port) {
+    Server server;
+    check(server.init(port), "server init");
+    Client client;
+    check(client.init("127.0.0.1", port), "client init");
+
+    size_t received = 0;
+    client.set_reverse_metadata_callback([&](void *, Array *) { ++received; }, nullptr);
+
+    auto update = [&]() {
+        check(server.update(), "server update");
+        check(client.update(), "client update");
+    };
+    connect_loopback(server, client);
+
+    Array array;
+    array.push_back_object(key_value("key", "value"));
+    auto deliver = [&](size_t count) {
+        const size_t expected = received + count;
+        const auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (received < expected) {
+            if (Clock::now() > deadline) {
+                std::fprintf(stderr, "loopback delivery timed out\n");
+                std::exit(1);
+            }
+            update();
+        }
+    };
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(iterations);
+    for (size_t i = 0; i < iterations; ++i) {
+        const auto start = Clock::now();
+        check(server.send_reverse_metadata(&array), "send_reverse_metadata");
+        deliver(1);
+        latencies_us.push_back(nanoseconds_since(start, 1) / 1000.0);
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const double p50_us = latencies_us[latencies_us.size() / 2];
+    const double p99_us = latencies_us[latencies_us.size() * 99 / 100];
+
+    // Bursts within the capacity of the queues.
+    const size_t burst = 32;
+    const auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0; j < burst; ++j) {
+            check(server.send_reverse_metadata(&array), "send_reverse_metadata");
+        }
+        deliver(burst);
+    }
+    const double message_ns = nanoseconds_since(start, iterations * burst);
+
+    client.shutdown();
+    server.shutdown();
+
+    std::printf(
+        ",\"loopback\":{\"messages_per_second\":%.0f,\"p50_us\":%.1f,\"p99_us\":%.1f}",
+        1e9 / message_ns, p50_us, p99_us);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    size_t iterations = 10000;
+    unsigned int port = 19160;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--iterations") == 0) {
+            iterations = std::max<size_t>(1, std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--port") == 0) {
+            port = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--iterations N] [--port PORT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("{\"iterations\":%zu,", iterations);
+    bench_codec(iterations);
+    bench_compression(std::max<size_t>(iterations / 10, 1));
+    bench_payload(iterations);
+    bench_buffers(iterations);
+    bench_live_state(iterations);
+    bench_loopback(std::max<size_t>(iterations / 10, 1), port);
+    bench_live_state_contention(std::max<size_t>(iterations / 10, 1), port + 1);
+    std::printf("}\n");
+    return 0;
+}
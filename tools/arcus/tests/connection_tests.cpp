@@ -0,0 +1,236 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include "test.h"
+
+#include <one/arcus/array.h>
+#include <one/arcus/internal/codec.h>
+#include <one/arcus/internal/connection.h>
+#include <one/arcus/internal/poller.h>
+#include <one/arcus/internal/socket.h>
+#include <one/arcus/message.h>
+#include <one/arcus/opcode.h>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace i3d::one;
+
+namespace {
+
+// A connection initiating the handshake with an agent played by the test
+// through a raw socket.
+class Link {
+public:
+    Link()
+        : _deadline(std::chrono::steady_clock::now() + std::chrono::seconds(5))
+        , _connection(connection::sizes(MemoryProfile::throughput)) {
+        CHECK(!is_error(init_socket_system()));
+        const unsigned int port = test::next_port();
+        CHECK(!is_error(_listener.init()));
+        CHECK(!is_error(_listener.bind(port)));
+        CHECK(!is_error(_listener.listen(1)));
+        CHECK(!is_error(agent.init()));
+        CHECK(!is_error(agent.connect("127.0.0.1", port)));
+
+        String ip;
+        unsigned int accepted_port = 0;
+        while (!socket.is_initialized()) {
+            check_deadline();
+            CHECK(!is_error(_listener.accept(socket, ip, accepted_port)));
+        }
+
+        CHECK(!is_error(poller.init()));
+        CHECK(!is_error(poller.add(socket)));
+        _connection.init(socket, poller);
+        CHECK(!is_error(_connection.initiate_handshake()));
+    }
+
+    ~Link() {
+        _connection.shutdown();
+        poller.shutdown();
+        socket.close();
+        agent.close();
+        _listener.close();
+        shutdown_socket_system();
+    }
+
+    Connection &connection() {
+        return _connection;
+    }
+
+    void check_deadline() const {
+        CHECK(std::chrono::steady_clock::now() < _deadline);
+    }
+
+    // Sends the hello and receives it on the agent.
+    void send_hello() {
+        while (_connection.status() != Connection::Status::handshake_hello_sent) {
+            check_deadline();
+            CHECK(!is_error(poller.poll(0)));
+            CHECK(!is_error(_connection.update()));
+        }
+
+        codec::Hello hello{};
+        size_t received = 0;
+        while (received < codec::hello_size()) {
+            check_deadline();
+            size_t length = 0;
+            CHECK(!is_error(agent.receive(reinterpret_cast<char *>(&hello) + received,
+                                          codec::hello_size() - received, length)));
+            received += length;
+        }
+    }
+
+    // Sends the hello reply from the agent, followed in the same segment by
+    // the given message, if any, and updates until the connection is ready.
+    void send_hello_reply(const Message *message) {
+        std::vector<char> data(codec::header_size() + codec::payload_max_size());
+        std::array<char, codec::header_size()> reply;
+        const codec::Header header{0, static_cast<char>(Opcode::hello), {0, 0}, 0, 0};
+        CHECK(!is_error(codec::header_to_data(header, reply)));
+        std::memcpy(data.data(), reply.data(), reply.size());
+        size_t length = 0;
+        if (message != nullptr) {
+            CHECK(!is_error(codec::message_to_data(
+                1, *message, codec::encode_options(codec::capability::none, 0, nullptr),
+                data.data() + reply.size(), data.size() - reply.size(), length)));
+        }
+        length += reply.size();
+        size_t sent = 0;
+        CHECK(!is_error(agent.send(data.data(), length, sent)));
+        CHECK(sent == length);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        while (_connection.status() != Connection::Status::ready) {
+            check_deadline();
+            CHECK(!is_error(poller.poll(10)));
+            CHECK(!is_error(_connection.update()));
+        }
+    }
+
+    // Sends the message from the agent and updates until it is queued.
+    void send_message(int packet_id, const Message &message) {
+        std::vector<char> data(codec::header_size() + codec::payload_max_size());
+        size_t length = 0;
+        CHECK(!is_error(codec::message_to_data(
+            packet_id, message, codec::encode_options(codec::capability::none, 0, nullptr),
+            data.data(), data.size(), length)));
+        size_t sent = 0;
+        CHECK(!is_error(agent.send(data.data(), length, sent)));
+        CHECK(sent == length);
+
+        unsigned int count = 0;
+        CHECK(!is_error(_connection.incoming_count(count)));
+        const unsigned int expected = count + 1;
+        while (count < expected) {
+            check_deadline();
+            CHECK(!is_error(poller.poll(10)));
+            CHECK(!is_error(_connection.update()));
+            CHECK(!is_error(_connection.incoming_count(count)));
+        }
+    }
+
+    Socket agent;
+    Socket socket;
+    Poller poller;
+
+private:
+    const std::chrono::steady_clock::time_point _deadline;
+    Socket _listener;
+    Connection _connection;
+};
+
+}  // namespace
+
+TEST_CASE(connection_reads_frames_received_with_the_hello_reply) {
+    Link link;
+    Connection &connection = link.connection();
+    link.send_hello();
+    Message message;
+    CHECK(!is_error(messages::prepare_soft_stop(1, message)));
+    link.send_hello_reply(&message);
+
+    // The soft stop is left in the stream, and the socket is drained.
+    unsigned int count = 0;
+    CHECK(!is_error(connection.incoming_count(count)));
+    CHECK(count == 0);
+    CHECK(connection.has_pending_incoming());
+    CHECK(!is_error(link.poller.poll(0)));
+    CHECK(!link.poller.is_readable(link.socket));
+
+    CHECK(!is_error(connection.update()));
+    CHECK(!is_error(connection.incoming_count(count)));
+    CHECK(count == 1);
+    CHECK(!connection.has_pending_incoming());
+}
+
+TEST_CASE(connection_ignores_spurious_readiness) {
+    Link link;
+    Connection &connection = link.connection();
+    link.send_hello();
+    link.send_hello_reply(nullptr);
+
+    // The socket is reported readable, but emptied before the update.
+    const char byte = 0;
+    size_t sent = 0;
+    CHECK(!is_error(link.agent.send(&byte, 1, sent)));
+    CHECK(sent == 1);
+    while (!link.poller.is_readable(link.socket)) {
+        link.check_deadline();
+        CHECK(!is_error(link.poller.poll(10)));
+    }
+    char received_byte = 0;
+    size_t received = 0;
+    CHECK(!is_error(link.socket.receive(&received_byte, 1, received)));
+    CHECK(received == 1);
+
+    CHECK(!is_error(connection.update()));
+    CHECK(connection.status() == Connection::Status::ready);
+}
+
+TEST_CASE(connection_reports_the_peer_closing) {
+    Link link;
+    Connection &connection = link.connection();
+    link.send_hello();
+    link.send_hello_reply(nullptr);
+
+    CHECK(!is_error(link.agent.close()));
+    while (!link.poller.is_readable(link.socket)) {
+        link.check_deadline();
+        CHECK(!is_error(link.poller.poll(10)));
+    }
+    CHECK(connection.update() == ONE_ERROR_CONNECTION_CLOSED_BY_PEER);
+    CHECK(connection.status() == Connection::Status::error);
+}
+
+TEST_CASE(connection_arena_stays_bounded_while_the_queue_never_empties) {
+    Link link;
+    Connection &connection = link.connection();
+    link.send_hello();
+    link.send_hello_reply(nullptr);
+
+    Array array;
+    for (int i = 0; i < 32; ++i) {
+        array.push_back_string("a string value long enough to be copied by the parser");
+    }
+    Message message;
+    CHECK(!is_error(messages::prepare_metadata(array, message)));
+
+    // Each message read is replaced by a new one, so that the queue is never
+    // emptied, and its payload is decoded as the callbacks do.
+    auto decode = [](const Message &received) {
+        CHECK(received.payload().is_val_array("data"));
+        return ONE_ERROR_NONE;
+    };
+    int packet_id = 1;
+    link.send_message(packet_id++, message);
+    size_t capacity = 0;
+    for (int i = 0; i < 200; ++i) {
+        link.send_message(packet_id++, message);
+        CHECK(!is_error(connection.remove_incoming(decode)));
+        if (i == 0) capacity = connection.incoming_arena_capacity();
+        CHECK(connection.incoming_arena_capacity() == capacity);
+    }
+}
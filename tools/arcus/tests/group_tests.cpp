@@ -0,0 +1,79 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include "test.h"
+
+#include <one/arcus/client.h>
+#include <one/arcus/internal/connection.h>
+#include <one/arcus/server.h>
+#include <one/arcus/server_group.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
+using namespace i3d::one;
+
+TEST_CASE(group_callback_destroys_other_server) {
+    ServerGroup group;
+    CHECK(!is_error(group.init()));
+
+    const unsigned int port = test::next_port();
+    const unsigned int other_port = test::next_port();
+    Server server;
+    CHECK(!is_error(group.add(server, port)));
+    std::unique_ptr<Server> other(new Server());
+    CHECK(!is_error(group.add(*other, other_port)));
+
+    Client client;
+    CHECK(!is_error(client.init("127.0.0.1", port)));
+    Client other_client;
+    CHECK(!is_error(other_client.init("127.0.0.1", other_port)));
+    auto update_group = [&]() { CHECK(!is_error(group.update())); };
+    test::connect(server, client, update_group);
+    test::connect(*other, other_client, update_group);
+
+    // Both servers are ready in the same update, whichever is updated first.
+    server.set_soft_stop_callback([&](void *, int) { other.reset(); }, nullptr);
+    CHECK(!is_error(client.send_soft_stop(1)));
+    CHECK(!is_error(other_client.send_soft_stop(1)));
+    CHECK(!is_error(client.update()));
+    CHECK(!is_error(other_client.update()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto update = std::async(std::launch::async, [&]() { return group.update(); });
+    CHECK(update.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CHECK(!is_error(update.get()));
+    CHECK(other == nullptr);
+    CHECK(group.size() == 1);
+    CHECK(!is_error(group.update()));
+
+    client.shutdown();
+    other_client.shutdown();
+    CHECK(!is_error(group.shutdown()));
+}
+
+TEST_CASE(group_wait_returns_while_reading_is_paused) {
+    const unsigned int port = test::next_port();
+    ServerGroup group;
+    CHECK(!is_error(group.init()));
+    Server server;
+    CHECK(!is_error(group.add(server, port)));
+    Client client;
+    CHECK(!is_error(client.init("127.0.0.1", port)));
+    int soft_stops = 0;
+    server.set_soft_stop_callback([&](void *, int) { ++soft_stops; }, nullptr);
+    test::connect(server, client, [&]() { CHECK(!is_error(group.update())); });
+
+    const int count = test::send_soft_stop_burst(client);
+    CHECK(!is_error(group.update()));
+    CHECK(soft_stops == static_cast<int>(Connection::max_message_default));
+
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(!is_error(group.wait(1000)));
+    CHECK(test::elapsed_ms(start) < 100);
+    CHECK(!is_error(group.update()));
+    CHECK(soft_stops == count);
+
+    client.shutdown();
+    group.shutdown();
+}
@@ -0,0 +1,44 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include "test.h"
+
+#include <one/arcus/client.h>
+#include <one/arcus/internal/connection.h>
+#include <one/arcus/server.h>
+
+#include <chrono>
+#include <thread>
+
+namespace i3d {
+namespace one {
+namespace test {
+
+void connect(Server &server, Client &client, std::function<void()> update_server) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (server.status() != Server::Status::ready ||
+           client.status() != Client::Status::ready) {
+        CHECK(std::chrono::steady_clock::now() < deadline);
+        update_server();
+        CHECK(!is_error(client.update()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int send_soft_stop_burst(Client &client) {
+    const int count = static_cast<int>(Connection::max_message_default) + 16;
+    for (int sent = 0; sent < count; ++sent) {
+        CHECK(!is_error(client.send_soft_stop(1)));
+        CHECK(!is_error(client.update()));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return count;
+}
+
+int elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count());
+}
+
+}  // namespace test
+}  // namespace one
+}  // namespace i3d
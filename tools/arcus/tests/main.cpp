@@ -0,0 +1,66 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+//
+// Runs the Arcus tests: all of them, or those named on the command line.
+//
+// Usage: arcus_tests [name...]
+
+#include "test.h"
+
+#include <cstring>
+#include <vector>
+
+namespace i3d {
+namespace one {
+namespace test {
+
+namespace {
+
+struct Test {
+    const char *name;
+    Function function;
+};
+
+std::vector<Test> &tests() {
+    static std::vector<Test> registered;
+    return registered;
+}
+
+}  // namespace
+
+Registration::Registration(const char *name, Function function) {
+    tests().push_back({name, function});
+}
+
+unsigned int next_port() {
+    static unsigned int port = 19200;
+    return port++;
+}
+
+}  // namespace test
+}  // namespace one
+}  // namespace i3d
+
+int main(int argc, char **argv) {
+    using i3d::one::test::tests;
+
+    size_t run = 0;
+    for (const auto &test : tests()) {
+        bool is_selected = (argc == 1);
+        for (int i = 1; i < argc; ++i) {
+            is_selected = is_selected || std::strcmp(argv[i], test.name) == 0;
+        }
+        if (!is_selected) continue;
+
+        std::printf("%s\n", test.name);
+        std::fflush(stdout);
+        test.function();
+        ++run;
+    }
+
+    if (run == 0) {
+        std::fprintf(stderr, "no test matched\n");
+        return 1;
+    }
+    std::printf("%zu tests passed\n", run);
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include "test.h"
+
+#include <one/arcus/internal/json.h>
+#include <one/arcus/message.h>
+
+#include <cstring>
+#include <utility>
+
+using namespace i3d::one;
+
+TEST_CASE(payload_moved_from_an_arena_outlives_its_content) {
+    const char json[] = "{\"key\":\"a value longer than a short string\",\"count\":3}";
+    char buffer[4096];
+    JsonArena arena(buffer, sizeof(buffer), json::arena_chunk_size());
+
+    Payload parsed(&arena);
+    CHECK(!is_error(parsed.from_json({json, std::strlen(json)})));
+    Payload moved(std::move(parsed));
+
+    // The memory of the arena is reused for other values.
+    parsed.clear();
+    arena.Clear();
+    const char other_json[] = "{\"other\":\"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\"}";
+    Payload other(&arena);
+    CHECK(!is_error(other.from_json({other_json, std::strlen(other_json)})));
+
+    const String result = moved.to_json();
+    CHECK(result == json);
+    other.clear();
+}
+
+TEST_CASE(payload_moved_from_a_pool_outlives_its_content) {
+    const char json[] = "{\"key\":\"a value longer than a short string\",\"count\":3}";
+    Payload parsed;
+    CHECK(!is_error(parsed.from_json({json, std::strlen(json)})));
+    Payload moved;
+    moved = std::move(parsed);
+
+    // The pool of the moved from payload is reused for other values.
+    const char other_json[] = "{\"other\":\"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\"}";
+    CHECK(!is_error(parsed.from_json({other_json, std::strlen(other_json)})));
+
+    const String result = moved.to_json();
+    CHECK(result == json);
+    CHECK(parsed.to_json() == other_json);
+}
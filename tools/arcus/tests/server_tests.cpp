@@ -0,0 +1,225 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#include "test.h"
+
+#include <one/arcus/array.h>
+#include <one/arcus/client.h>
+#include <one/arcus/internal/connection.h>
+#include <one/arcus/object.h>
+#include <one/arcus/server.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace i3d::one;
+
+TEST_CASE(server_wait_returns_while_reading_is_paused) {
+    const unsigned int port = test::next_port();
+    Server server;
+    CHECK(!is_error(server.init(port)));
+    Client client;
+    CHECK(!is_error(client.init("127.0.0.1", port)));
+    int soft_stops = 0;
+    server.set_soft_stop_callback([&](void *, int) { ++soft_stops; }, nullptr);
+    test::connect(server, client, [&]() { CHECK(!is_error(server.update())); });
+
+    const int count = test::send_soft_stop_burst(client);
+    CHECK(!is_error(server.update()));
+    CHECK(soft_stops == static_cast<int>(Connection::max_message_default));
+
+    // The rest of the burst is pending behind the paused read.
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(!is_error(server.wait(1000)));
+    CHECK(test::elapsed_ms(start) < 100);
+    CHECK(!is_error(server.update()));
+    CHECK(soft_stops == count);
+
+    client.shutdown();
+    server.shutdown();
+}
+
+// The additional data is told apart by its version, including from another
+// object at the same address.
+TEST_CASE(server_sends_live_state_changes_of_the_additional_data) {
+    const unsigned int port = test::next_port();
+    Server server;
+    CHECK(!is_error(server.init(port)));
+    Client client;
+    CHECK(!is_error(client.init("127.0.0.1", port)));
+    int live_states = 0;
+    String last_name;
+    client.set_live_state_callback(
+        [&](void *, int, int, const String &name, const String &, const String &,
+            const String &) {
+            ++live_states;
+            last_name = name;
+        },
+        nullptr);
+    test::connect(server, client, [&]() { CHECK(!is_error(server.update())); });
+
+    // Updates until the given count of live states is received, then a while
+    // longer for any unexpected one.
+    auto receive = [&](int count) {
+        const auto start = std::chrono::steady_clock::now();
+        while (live_states < count || test::elapsed_ms(start) < 50) {
+            CHECK(test::elapsed_ms(start) < 5000);
+            CHECK(!is_error(server.update()));
+            CHECK(!is_error(client.update()));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(live_states == count);
+    };
+
+    Object data;
+    CHECK(!is_error(data.set_val_int("round", 1)));
+    CHECK(!is_error(server.set_live_state(1, 8, "name", "map", "mode", "1", &data)));
+    receive(1);
+    CHECK(!is_error(server.set_live_state(1, 8, "name", "map", "mode", "1", &data)));
+    receive(1);
+
+    CHECK(!is_error(data.set_val_int("round", 2)));
+    CHECK(!is_error(server.set_live_state(1, 8, "name", "map", "mode", "1", &data)));
+    receive(2);
+
+    for (int round = 3; round <= 4; ++round) {
+        Object other;
+        CHECK(!is_error(other.set_val_int("round", round)));
+        CHECK(!is_error(server.set_live_state(1, 8, "name", "map", "mode", "1", &other)));
+        receive(round);
+    }
+
+    CHECK(!is_error(server.set_live_state(1, 8, "other", "map", "mode", "1", nullptr)));
+    receive(5);
+    CHECK(last_name == "other");
+
+    client.shutdown();
+    server.shutdown();
+}
+
+namespace {
+
+// A server and the client connected to it, exchanging numbered messages in
+// both directions: metadata from the client, reverse metadata from the server.
+struct Pair {
+    Server server;
+    Client client;
+    int index = 0;
+    int metadata_sent = 0;
+    int metadata_received = 0;
+    int reverse_metadata_sent = 0;
+    int reverse_metadata_received = 0;
+    int corrupted = 0;
+};
+
+// Long enough to span several reads of the other pairs' streams.
+String message_text(int pair, int sequence) {
+    const std::string prefix = std::to_string(pair) + ":" + std::to_string(sequence) + ":";
+    String text(prefix.c_str());
+    while (text.size() < 512) {
+        text += static_cast<char>('a' + (pair * 7 + sequence + text.size()) % 26);
+    }
+    return text;
+}
+
+Array message_data(int pair, int sequence) {
+    Array array;
+    array.push_back_int(pair);
+    array.push_back_int(sequence);
+    array.push_back_string(message_text(pair, sequence));
+    return array;
+}
+
+// Whether the data is the next message of the pair.
+bool is_intact(Array *array, int pair, int sequence) {
+    int received_pair = -1;
+    int received_sequence = -1;
+    String text;
+    return array != nullptr && array->size() == 3 &&
+           !is_error(array->val_int(0, received_pair)) && received_pair == pair &&
+           !is_error(array->val_int(1, received_sequence)) &&
+           received_sequence == sequence && !is_error(array->val_string(2, text)) &&
+           text == message_text(pair, sequence);
+}
+
+}  // namespace
+
+// Each pair is updated from its own thread, so that state shared between
+// connections shows up as corrupted or missing messages, or as a data race
+// under TSan.
+TEST_CASE(servers_update_concurrently) {
+    const int pair_count = 8;
+    const int iterations = 400;
+    const int message_count = 200;
+    // Messages sent but not yet received, within the capacity of the queues.
+    const int window = 8;
+
+    std::vector<std::unique_ptr<Pair>> pairs;
+    for (int i = 0; i < pair_count; ++i) {
+        pairs.emplace_back(new Pair());
+        Pair &pair = *pairs.back();
+        pair.index = i;
+        const unsigned int port = test::next_port();
+        CHECK(!is_error(pair.server.init(port)));
+        CHECK(!is_error(pair.client.init("127.0.0.1", port)));
+        CHECK(!is_error(pair.server.set_metadata_callback(
+            [&pair](void *, Array *array) {
+                if (!is_intact(array, pair.index, pair.metadata_received)) ++pair.corrupted;
+                ++pair.metadata_received;
+            },
+            nullptr)));
+        CHECK(!is_error(pair.client.set_reverse_metadata_callback(
+            [&pair](void *, Array *array) {
+                if (!is_intact(array, pair.index, pair.reverse_metadata_received)) {
+                    ++pair.corrupted;
+                }
+                ++pair.reverse_metadata_received;
+            },
+            nullptr)));
+        test::connect(pair.server, pair.client,
+                      [&pair]() { CHECK(!is_error(pair.server.update())); });
+    }
+
+    // The updates continue after the iterations until every message arrived,
+    // for slower builds such as those of the sanitizers.
+    auto run = [&](Pair &pair) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        for (int i = 0; i < iterations || pair.metadata_received < message_count ||
+                        pair.reverse_metadata_received < message_count;
+             ++i) {
+            if (std::chrono::steady_clock::now() > deadline) break;
+            if (pair.metadata_sent < message_count &&
+                pair.metadata_sent - pair.metadata_received < window) {
+                Array data = message_data(pair.index, pair.metadata_sent);
+                if (!is_error(pair.client.send_metadata(data))) ++pair.metadata_sent;
+            }
+            if (pair.reverse_metadata_sent < message_count &&
+                pair.reverse_metadata_sent - pair.reverse_metadata_received < window) {
+                Array data = message_data(pair.index, pair.reverse_metadata_sent);
+                if (!is_error(pair.server.send_reverse_metadata(&data))) {
+                    ++pair.reverse_metadata_sent;
+                }
+            }
+            CHECK(!is_error(pair.server.update()));
+            CHECK(!is_error(pair.client.update()));
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (auto &pair : pairs) {
+        threads.emplace_back(run, std::ref(*pair));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (auto &pair : pairs) {
+        CHECK(pair->corrupted == 0);
+        CHECK(pair->metadata_received == message_count);
+        CHECK(pair->reverse_metadata_received == message_count);
+        pair->client.shutdown();
+        pair->server.shutdown();
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright i3D.net, 2021. All Rights Reserved.
+#pragma once
+
+// Minimal test registry of the Arcus tests. Each test is a function registered
+// by TEST_CASE, run by main in registration order, or by name.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+namespace i3d {
+namespace one {
+namespace test {
+
+using Function = void (*)();
+
+// Registers a test, see TEST_CASE.
+struct Registration {
+    Registration(const char *name, Function function);
+};
+
+// A free port on the loopback interface for a test server.
+unsigned int next_port();
+
+}  // namespace test
+
+class Client;
+class Server;
+
+namespace test {
+
+// Updates the client and, with the given function, the server, until both are
+// ready. Fails after five seconds.
+void connect(Server &server, Client &client, std::function<void()> update_server);
+
+// Sends more soft stops from the client than the incoming queue of a server
+// holds, and waits for them to reach its socket. Returns their count.
+int send_soft_stop_burst(Client &client);
+
+// Milliseconds elapsed since the given time.
+int elapsed_ms(std::chrono::steady_clock::time_point start);
+
+}  // namespace test
+}  // namespace one
+}  // namespace i3d
+
+#define TEST_CASE(name)                                                     \
+    static void name();                                                     \
+    static const ::i3d::one::test::Registration name##_registration(#name, \
+                                                                    name); \
+    static void name()
+
+// Fails the running test, exiting the process.
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                         #condition);                                             \
+            std::exit(1);                                                         \
+        }                                                                         \
+    } while (0)